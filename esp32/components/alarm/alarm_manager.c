@@ -48,8 +48,13 @@ esp_err_t alarm_manager_init() {
  * @param heart_rate Heart rate in BPM
  * @param spo2 Blood oxygen saturation (%)
  * @param temperature Body temperature (°C)
+ * @param ppg_valid false when heart_rate/spo2 come from an invalid PPG
+ *                  reading (no finger, poor signal); only temperature is checked
+ * @param confidence heart_rate_data_t.confidence; below HEART_RATE_CONFIDENCE_MIN
+ *                   the reading is treated like an invalid one
  */
-void alarm_check_health_data(int heart_rate, double spo2, float temperature) {
+void alarm_check_health_data(int heart_rate, double spo2, float temperature, bool ppg_valid,
+                             uint8_t confidence) {
     alarm_type_t new_alarm = ALARM_NONE;
 
     // Clear previous health-related alarm flags
@@ -58,17 +63,21 @@ void alarm_check_health_data(int heart_rate, double spo2, float temperature) {
                        (1 << ALARM_SPO2_LOW) | 
                        (1 << ALARM_TEMP_HIGH));
 
+    // HR and SpO2 only from a valid reading the pipeline trusts: a noisy
+    // window must not page anyone
+    ppg_valid = ppg_valid && confidence >= HEART_RATE_CONFIDENCE_MIN;
+
     // Check heart rate
-    if (heart_rate < HR_MIN_NORMAL) {
+    if (ppg_valid && heart_rate < HR_MIN_NORMAL) {
         new_alarm = ALARM_HEART_RATE_LOW;
         s_alarm_flags |= (1 << ALARM_HEART_RATE_LOW);
     } 
-    else if (heart_rate > HR_MAX_NORMAL) {
+    else if (ppg_valid && heart_rate > HR_MAX_NORMAL) {
         new_alarm = ALARM_HEART_RATE_HIGH;
         s_alarm_flags |= (1 << ALARM_HEART_RATE_HIGH);
     }
     // Check SpO2
-    else if (spo2 < SPO2_MIN_NORMAL) {
+    else if (ppg_valid && spo2 < SPO2_MIN_NORMAL) {
         new_alarm = ALARM_SPO2_LOW;
         s_alarm_flags |= (1 << ALARM_SPO2_LOW);
     }
@@ -17,8 +17,13 @@ esp_err_t alarm_manager_init();
  * @param heart_rate Heart rate in BPM
  * @param spo2 Blood oxygen saturation (%)
  * @param temperature Body temperature (°C)
+ * @param ppg_valid false when heart_rate/spo2 come from an invalid PPG
+ *                  reading (no finger, poor signal); only temperature is checked
+ * @param confidence heart_rate_data_t.confidence; below HEART_RATE_CONFIDENCE_MIN
+ *                   the reading is treated like an invalid one
  */
-void alarm_check_health_data(int heart_rate, double spo2, float temperature);
+void alarm_check_health_data(int heart_rate, double spo2, float temperature, bool ppg_valid,
+                             uint8_t confidence);
 
 /**
  * @brief Trigger SOS alarm (manual emergency button)
@@ -14,7 +14,12 @@
 #define ATTRIBUTES_TOPIC        "v1/devices/me/attributes"
 #define ATTR_REQUEST_TOPIC      "v1/devices/me/attributes/request/1"
 #define ATTR_RESPONSE_TOPIC     "v1/devices/me/attributes/response/+"
+#define SPO2_CALIB_ATTR         "spo2Calib"   // Shared attribute: {"lot":..,"r":[..],"spo2":[..]}
+#define FALL_CONFIG_ATTR        "fallConfig"  // Shared attribute: {"ffG":..,"impactG":..,...}
+#define FALL_MODEL_ATTR         "fallModel"   // Shared attribute: {"enabled":..,"nodes":[[f,t,b,a],..]}
+#define PPG_RATE_ATTR           "ppgRate"     // Shared attribute: effective PPG rate in Hz, applied at boot
 #define MQTT_RECONNECT_DELAY_MS 5000
+#define MQTT_ATTR_CB_MAX        4             // Shared attributes with a registered handler
 
 // NVS Storage Keys
 #define NVS_NAMESPACE           "wifi_config"
@@ -24,6 +29,10 @@
 #define NVS_KEY_DOCTOR          "doctor"
 #define NVS_KEY_TOKEN           "token"
 #define NVS_KEY_NEED_PROVISION  "need_prov"
+#define NVS_KEY_PPG_RATE        "ppg_rate"
+#define NVS_KEY_SPO2_CALIB      "spo2_calib"
+#define NVS_KEY_FALL_CONFIG     "fall_cfg"
+#define NVS_KEY_FALL_MODEL      "fall_model"
 
 // Buffer Sizes
 #define SSID_MAX_LEN            32
@@ -43,7 +52,24 @@
 #define I2C_SDA_PIN             GPIO_NUM_21
 #define I2C_SCL_PIN             GPIO_NUM_22
 #define I2C_FREQ_HZ             100000
-#define MAX30102_BUFFER_SIZE    128
+#define MAX30102_FIFO_POLL_MS   200           // Cap on the polled drain period (half the FIFO at the effective rate)
+#define MAX30102_INT_PIN        GPIO_NUM_19   // MAX30102 INT (GPIO_NUM_NC = poll the FIFO instead)
+#define MAX30102_FIFO_A_FULL    15            // Empty slots left when A_FULL fires (15 -> 17 samples)
+#define MAX30102_INT_TIMEOUT_MS 1000          // Safety timeout while waiting for A_FULL
+#define MAX30102_LED_PA         0x24          // 7.2 mA (0.2 mA/step): auto-gain start, presence reference
+#define MAX30102_ADC_RANGE      0b01          // SPO2_ADC_RGE 4096 nA: auto-gain start, presence reference
+#define MAX30102_PROBE_LED_PA   0x04          // 0.8 mA while waiting for a finger
+#define HEART_RATE_PROBE_MS     1000          // Finger-presence check period when unworn
+#define HEART_RATE_SAMPLE_RATE_HZ 50          // Default effective PPG rate (25/50/100 Hz, NVS "ppg_rate" overrides)
+#define HEART_RATE_HOP_SAMPLES  16            // New PPG samples between HR/SpO2 estimates (~320 ms at 50 Hz)
+#define HEART_RATE_STREAM_FILTER 1            // 1 = IIR band-pass per sample, 0 = block detrend per window
+#define HEART_RATE_ESTIMATOR    HR_ESTIMATOR_AUTOCORRELATION  // or HR_ESTIMATOR_SPECTRAL / _BEATS
+#define HEART_RATE_HRV_HORIZON_S 60           // RR intervals behind SDNN/RMSSD/pNN50
+#define HEART_RATE_HRV_MIN_RR   10            // Fewer intervals -> HRV not published
+#define HEART_RATE_RESP_UPDATE_S 5           // Respiratory-rate estimate period (s)
+#define HEART_RATE_CONFIDENCE_MIN 50          // Below this (0-100) HR/SpO2 raise no alarm and are not published
+#define HEART_RATE_MOTION_CANCEL 1            // 1 = NLMS artifact cancellation against the MPU6050 accel
+#define HEART_RATE_BENCHMARK    0             // 1 = log cycles/BPM of both estimators per window
 
 // Provisioning Configuration
 #define PROVISION_URL           "http://demo.thingsboard.io/api/v1/provision"
@@ -56,26 +82,23 @@
 
 // Task Delays (in milliseconds)
 #define TEMP_READ_DELAY_MS      2000
-#define HEART_READ_DELAY_MS     2000
 #define MQTT_SEND_DELAY_MS      5000
 #define OLED_UPDATE_DELAY_MS    500
 #define OTA_CHECK_INTERVAL_MS   (60000 * 5)  // 5 minutes
 
+// Task layout (table and deadlines in task_map.c)
+#define TASK_MAP_PINNING        1             // 0 = no core affinity, for jitter comparisons
+#define TASK_JITTER_LOG_PERIODS 500           // Log sampling-loop jitter every N periods (0 = off)
+
 // MPU6050 Fall Detection Configuration
 #define MPU6050_ADDR            0x68
-#define MPU_PERIOD_MS           200           // Sampling period
-#define QUEUE_LEN               16            // Queue size for sensor data
-
-// Fall detection thresholds (adjust based on testing)
-#define FF_G_THRESH             0.35f         // Free-fall threshold (g)
-#define FF_MIN_TIME_MS          120           // Minimum free-fall duration (ms)
-#define FF_MAX_TIME_MS          1000          // Maximum free-fall before impact (ms)
-#define IMPACT_G_THRESH         1.0f          // Impact threshold (g)
-#define IMPACT_TIMEOUT_MS       300           // Time window to detect impact after FF
-#define POST_INACT_DPS          10.0f         // Gyro inactivity threshold (dps)
-#define POST_ANGLE_DEG          45.0f         // Posture angle threshold (degrees)
-#define POST_WINDOW_MS          1500          // Post-impact monitoring window (ms)
-#define REPORT_COOLDOWN_MS      3000          // Prevent duplicate reports
+#define MPU_PERIOD_MS           50            // FIFO drain period (samples at MPU6050_SAMPLE_RATE_HZ, FIFO holds 730 ms)
+#define MPU_FIFO_BATCH          16            // Most samples taken per drain (5 due per period at 100 Hz)
+#define QUEUE_LEN               32            // Queue size for sensor data (a few drains of slack)
+#define MPU6050_INT_PIN         GPIO_NUM_23   // MPU6050 INT (GPIO_NUM_NC = capture continuously)
+#define MPU_WAKE_MOTION_G       0.08f         // On-chip motion wake: high-passed accel above this (g)...
+#define MPU_WAKE_MOTION_MS      2             // ...for this long
+#define MPU_IDLE_CHECK_MS       1000          // INT_STATUS re-check while waiting (missed edge)
 
 // Health Monitoring Thresholds
 #define HR_MIN_NORMAL           60
@@ -120,12 +143,4 @@ typedef enum {
     BTN_LONG_PRESS
 } button_event_id_t;
 
-// Fall detection states
-typedef enum {
-    ST_IDLE,           // Normal state
-    ST_FREE_FALL,      // Free-fall detected
-    ST_IMPACT_WAIT,    // Waiting for impact
-    ST_POST_MONITOR    // Monitoring post-impact posture
-} fall_state_t;
-
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <stdbool.h>
+#include "task_map.h"
+#include "sytem_config.h"
+#include "esp_log.h"
+
+static const char *TAG = "TASK_MAP";
+
+/*
+ * Sensing on APP_CPU, away from the WiFi/lwIP/MQTT tasks that ESP-IDF keeps
+ * on PRO_CPU; everything that talks to the network or the user goes there.
+ * Deadlines are what each task can tolerate before data is lost or stale.
+ */
+static const task_map_entry_t k_task_map[TASK_COUNT] = {
+    [TASK_PPG_ACQ]     = {"ppg_acq",         4096, APP_CPU_NUM, 150},   // 15 free FIFO slots at 100 Hz
+    [TASK_MPU]         = {"mpu6050_task",    4096, APP_CPU_NUM, MPU_PERIOD_MS},
+    [TASK_FALL]        = {"fall_detect",     4096, APP_CPU_NUM, 100},   // Impact shorter than FALL_IMPACT_TIMEOUT_MS
+    [TASK_TEMP]        = {"temp_task",       4096, APP_CPU_NUM, TEMP_READ_DELAY_MS},
+    [TASK_PPG_DSP]     = {"heart_rate_task", 6144, PRO_CPU_NUM, 320},   // One hop at 50 Hz
+    [TASK_OLED]        = {"oled_task",       4096, PRO_CPU_NUM, OLED_UPDATE_DELAY_MS},
+    [TASK_OLED_UPDATE] = {"oled_update",     2048, PRO_CPU_NUM, OLED_UPDATE_DELAY_MS},
+    [TASK_HTTPD]       = {"httpd",           4096, PRO_CPU_NUM, 1000},
+    [TASK_MQTT_SEND]   = {"mqtt_send",       4096, PRO_CPU_NUM, MQTT_SEND_DELAY_MS},
+    [TASK_OTA_EXEC]    = {"ota_exec",        8192, PRO_CPU_NUM, 60000},
+    [TASK_OTA_SCHED]   = {"ota_sched",       4096, PRO_CPU_NUM, OTA_CHECK_INTERVAL_MS},
+};
+
+const task_map_entry_t *task_map_get(task_id_t id) {
+    return &k_task_map[id];
+}
+
+UBaseType_t task_map_priority(task_id_t id) {
+    uint32_t deadline = k_task_map[id].deadline_ms;
+    UBaseType_t prio = TASK_MAP_PRIO_BASE;
+
+    // One level per distinct longer deadline; equal deadlines share a level
+    for (int i = 0; i < TASK_COUNT; i++) {
+        uint32_t d = k_task_map[i].deadline_ms;
+        if (d <= deadline) {
+            continue;
+        }
+        bool seen = false;
+        for (int k = 0; k < i; k++) {
+            if (k_task_map[k].deadline_ms == d) {
+                seen = true;
+                break;
+            }
+        }
+        if (!seen) {
+            prio++;
+        }
+    }
+    return prio;
+}
+
+BaseType_t task_map_core(task_id_t id) {
+#if TASK_MAP_PINNING
+    BaseType_t core = k_task_map[id].core;
+    return (core < portNUM_PROCESSORS) ? core : tskNO_AFFINITY;
+#else
+    return tskNO_AFFINITY;
+#endif
+}
+
+esp_err_t task_map_create(task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle) {
+    const task_map_entry_t *t = &k_task_map[id];
+    UBaseType_t prio = task_map_priority(id);
+    BaseType_t core = task_map_core(id);
+
+    if (xTaskCreatePinnedToCore(fn, t->name, t->stack, arg, prio, handle, core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create %s", t->name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "%s: priority %u, core %s (deadline %lu ms)", t->name, (unsigned)prio,
+             core == tskNO_AFFINITY ? "any" : (core == APP_CPU_NUM ? "APP" : "PRO"),
+             (unsigned long)t->deadline_ms);
+    return ESP_OK;
+}
+
+void task_jitter_init(task_jitter_t *j, const char *name) {
+    j->name = name;
+    j->last_us = 0;
+    j->count = 0;
+    j->sum_us = 0;
+    j->max_us = 0;
+}
+
+void task_jitter_mark(task_jitter_t *j, int64_t now_us, int64_t expected_us) {
+    if (j->last_us != 0) {
+        int64_t dev = (now_us - j->last_us) - expected_us;
+        uint32_t abs_dev = (uint32_t)(dev < 0 ? -dev : dev);
+
+        j->sum_us += abs_dev;
+        if (abs_dev > j->max_us) {
+            j->max_us = abs_dev;
+        }
+        j->count++;
+
+#if TASK_JITTER_LOG_PERIODS
+        if (j->count >= TASK_JITTER_LOG_PERIODS) {
+            ESP_LOGI(TAG, "%s jitter: mean %lu us, max %lu us over %lu periods (core %d)",
+                     j->name, (unsigned long)(j->sum_us / j->count), (unsigned long)j->max_us,
+                     (unsigned long)j->count, xPortGetCoreID());
+            j->count = 0;
+            j->sum_us = 0;
+            j->max_us = 0;
+        }
+#endif
+    }
+    j->last_us = now_us;
+}
@@ -0,0 +1,87 @@
+#ifndef TASK_MAP_H
+#define TASK_MAP_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TASK_MAP_PRIO_BASE  1       // Priority of the task with the longest deadline
+
+/**
+ * @brief Every application task, one row each in the task map
+ */
+typedef enum {
+    TASK_PPG_ACQ = 0,       // MAX30102 FIFO drain
+    TASK_MPU,               // MPU6050 sampling
+    TASK_FALL,              // Fall detector
+    TASK_TEMP,              // DS18B20
+    TASK_PPG_DSP,           // HR/SpO2 estimators
+    TASK_OLED,
+    TASK_OLED_UPDATE,
+    TASK_HTTPD,             // Configuration web server
+    TASK_MQTT_SEND,
+    TASK_OTA_EXEC,
+    TASK_OTA_SCHED,
+    TASK_COUNT
+} task_id_t;
+
+/**
+ * @brief Placement of one task
+ * @details The priority is not stored: it is derived from deadline_ms
+ *          (deadline monotonic, shorter deadline = higher priority), so
+ *          adding a row never means renumbering the others.
+ */
+typedef struct {
+    const char *name;
+    uint32_t stack;         // Bytes
+    BaseType_t core;        // APP_CPU_NUM for sensing, PRO_CPU_NUM for networking
+    uint32_t deadline_ms;   // Longest the task may wait before data is lost or late
+} task_map_entry_t;
+
+/**
+ * @brief Row of the task map
+ */
+const task_map_entry_t *task_map_get(task_id_t id);
+
+/**
+ * @brief Priority derived from the deadline
+ * @return TASK_MAP_PRIO_BASE + number of distinct longer deadlines in the map
+ */
+UBaseType_t task_map_priority(task_id_t id);
+
+/**
+ * @brief Core the task is pinned to
+ * @return tskNO_AFFINITY with TASK_MAP_PINNING 0 or on a single-core target
+ */
+BaseType_t task_map_core(task_id_t id);
+
+/**
+ * @brief xTaskCreatePinnedToCore() with the name, stack, priority and core of the map
+ */
+esp_err_t task_map_create(task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle);
+
+/**
+ * @brief Wake-up jitter of a periodic loop
+ * @details Each mark compares the time since the previous mark with the
+ *          expected period; the absolute difference is accumulated and
+ *          logged every TASK_JITTER_LOG_PERIODS marks.
+ */
+typedef struct {
+    const char *name;
+    int64_t last_us;        // Previous mark (0 = none)
+    uint32_t count;
+    uint64_t sum_us;        // Σ |actual - expected|
+    uint32_t max_us;
+} task_jitter_t;
+
+void task_jitter_init(task_jitter_t *j, const char *name);
+
+/**
+ * @brief Record one wake-up
+ * @param now_us      esp_timer_get_time() at the wake-up
+ * @param expected_us Period the loop should have had since the last mark
+ */
+void task_jitter_mark(task_jitter_t *j, int64_t now_us, int64_t expected_us);
+
+#endif
@@ -0,0 +1,211 @@
+#include <string.h>
+#include "fall_capture.h"
+
+static const char k_b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+// Base64 written three bytes at a time straight into the caller's buffer
+typedef struct {
+	char *out;
+	size_t cap;
+	size_t len;
+	uint32_t group;
+	int bytes;
+	bool full;
+} b64_writer_t;
+
+
+static void b64_flush(b64_writer_t *w)
+{
+	if (w->bytes == 0) {
+		return;
+	}
+	if (w->len + 4 >= w->cap) {     // Room for the terminator too
+		w->full = true;
+		return;
+	}
+	uint32_t g = w->group << (8 * (3 - w->bytes));
+	for (int i = 0; i < 4; i++) {
+		w->out[w->len + i] = (i <= w->bytes) ? k_b64[(g >> (18 - 6 * i)) & 0x3F] : '=';
+	}
+	w->len += 4;
+	w->group = 0;
+	w->bytes = 0;
+}
+
+
+static void b64_put(b64_writer_t *w, uint8_t b)
+{
+	w->group = (w->group << 8) | b;
+	if (++w->bytes == 3) {
+		b64_flush(w);
+	}
+}
+
+
+static int b64_value(char ch)
+{
+	if (ch >= 'A' && ch <= 'Z') return ch - 'A';
+	if (ch >= 'a' && ch <= 'z') return ch - 'a' + 26;
+	if (ch >= '0' && ch <= '9') return ch - '0' + 52;
+	if (ch == '+') return 62;
+	if (ch == '/') return 63;
+	return -1;
+}
+
+
+void fall_capture_init(fall_capture_t *c)
+{
+	memset(c, 0, sizeof(*c));
+	c->state = FALL_CAPTURE_RECORDING;
+}
+
+
+void fall_capture_push(fall_capture_t *c, const int16_t s[FALL_CAPTURE_AXES])
+{
+	if (c->state == FALL_CAPTURE_FROZEN) {
+		c->dropped = true;
+		return;
+	}
+	// Samples pushed before a freeze or a gap are not contiguous with the next ones
+	if (c->dropped || c->gap) {
+		c->dropped = false;
+		c->gap = false;
+		c->start = c->n;
+	}
+
+	memcpy(c->ring[c->n % FALL_CAPTURE_LEN], s, sizeof(c->ring[0]));
+	c->n++;
+	if (c->state == FALL_CAPTURE_POST_TRIGGER && c->n - c->trigger > FALL_CAPTURE_POST) {
+		c->state = FALL_CAPTURE_FROZEN;
+	}
+}
+
+
+void fall_capture_gap(fall_capture_t *c)
+{
+	c->gap = true;
+}
+
+
+bool fall_capture_trigger(fall_capture_t *c, int64_t t_us)
+{
+	if (c->state != FALL_CAPTURE_RECORDING || c->n == 0) {
+		return false;
+	}
+
+	c->trigger = c->n - 1;
+	c->first = (c->n - c->start > FALL_CAPTURE_PRE) ? c->n - FALL_CAPTURE_PRE : c->start;
+	c->t_trigger_us = t_us;
+	c->state = (FALL_CAPTURE_POST > 0) ? FALL_CAPTURE_POST_TRIGGER : FALL_CAPTURE_FROZEN;
+	return true;
+}
+
+
+bool fall_capture_frozen(const fall_capture_t *c)
+{
+	return c->state == FALL_CAPTURE_FROZEN;
+}
+
+
+uint32_t fall_capture_count(const fall_capture_t *c, uint32_t *pre)
+{
+	if (c->state != FALL_CAPTURE_FROZEN) {
+		*pre = 0;
+		return 0;
+	}
+	*pre = c->trigger - c->first;
+	return c->n - c->first;
+}
+
+
+size_t fall_capture_encode(const fall_capture_t *c, char *out, size_t cap)
+{
+	if (c->state != FALL_CAPTURE_FROZEN || cap == 0) {
+		return 0;
+	}
+
+	b64_writer_t w = {.out = out, .cap = cap};
+	int32_t prev[FALL_CAPTURE_AXES] = {0};
+	for (uint32_t i = c->first; i < c->n && !w.full; i++) {
+		const int16_t *s = c->ring[i % FALL_CAPTURE_LEN];
+		for (int k = 0; k < FALL_CAPTURE_AXES; k++) {
+			int32_t delta = s[k] - prev[k];
+			uint32_t z = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+			prev[k] = s[k];
+			while (z >= 0x80) {
+				b64_put(&w, (uint8_t)(z | 0x80));
+				z >>= 7;
+			}
+			b64_put(&w, (uint8_t)z);
+		}
+	}
+	b64_flush(&w);
+
+	if (w.full) {
+		return 0;
+	}
+	out[w.len] = '\0';
+	return w.len;
+}
+
+
+size_t fall_capture_decode(const char *text, int16_t (*out)[FALL_CAPTURE_AXES], size_t max)
+{
+	int32_t prev[FALL_CAPTURE_AXES] = {0};
+	uint32_t group = 0, z = 0;
+	int sextets = 0, shift = 0, axis = 0;
+	size_t count = 0;
+
+	for (const char *p = text; *p && *p != '='; p++) {
+		int v = b64_value(*p);
+		if (v < 0) {
+			return 0;
+		}
+		group = (group << 6) | (uint32_t)v;
+		if (++sextets < 4 && p[1] && p[1] != '=') {
+			continue;
+		}
+
+		// 4 sextets are 3 bytes; a padded tail of 2 or 3 holds 1 or 2
+		if (sextets == 1) {
+			return 0;
+		}
+		int bytes = sextets - 1;
+		group <<= 6 * (4 - sextets);
+		for (int b = 0; b < bytes; b++) {
+			uint8_t byte = (uint8_t)(group >> (16 - 8 * b));
+			z |= (uint32_t)(byte & 0x7F) << shift;
+			if (byte & 0x80) {
+				shift += 7;
+				if (shift > 14) {   // More than 3 bytes is not a 16-bit delta
+					return 0;
+				}
+				continue;
+			}
+			if (count == max) {
+				return count;
+			}
+			int32_t delta = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+			prev[axis] += delta;
+			out[count][axis] = (int16_t)prev[axis];
+			z = 0;
+			shift = 0;
+			if (++axis == FALL_CAPTURE_AXES) {
+				axis = 0;
+				count++;
+			}
+		}
+		group = 0;
+		sextets = 0;
+	}
+	// A sample cut short is malformed
+	return (axis == 0 && shift == 0) ? count : 0;
+}
+
+
+void fall_capture_release(fall_capture_t *c)
+{
+	// Only the state: the pushing task owns everything else
+	c->state = FALL_CAPTURE_RECORDING;
+}
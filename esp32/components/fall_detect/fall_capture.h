@@ -0,0 +1,112 @@
+#ifndef FALL_CAPTURE_H
+#define FALL_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FALL_CAPTURE_AXES   6       // ax, ay, az, gx, gy, gz
+#define FALL_CAPTURE_PRE    300     // Samples kept up to the trigger (3 s at 100 Hz)
+#define FALL_CAPTURE_POST   200     // Samples recorded after it (2 s)
+#define FALL_CAPTURE_LEN    (FALL_CAPTURE_PRE + FALL_CAPTURE_POST)
+
+// Longest fall_capture_encode() text: at most 3 varint bytes per value, base64, terminator
+#define FALL_CAPTURE_TEXT_MAX   ((FALL_CAPTURE_LEN * FALL_CAPTURE_AXES * 3 + 2) / 3 * 4 + 1)
+
+typedef enum {
+    FALL_CAPTURE_RECORDING = 0,     // Ring overwritten by every sample
+    FALL_CAPTURE_POST_TRIGGER,      // Triggered, recording the post-trigger samples
+    FALL_CAPTURE_FROZEN,            // Complete, waiting for fall_capture_release()
+} fall_capture_state_t;
+
+/**
+ * @brief Raw IMU samples around a fall
+ * @details A fixed ring of the last FALL_CAPTURE_LEN samples, as the
+ *          sensor's int16 counts. A trigger keeps it running for
+ *          FALL_CAPTURE_POST more samples, then freezes it until the
+ *          capture is sent, so the ring then holds FALL_CAPTURE_PRE
+ *          samples up to the trigger and FALL_CAPTURE_POST after (fewer
+ *          before if the stream started less than FALL_CAPTURE_PRE
+ *          samples earlier). Nothing is allocated: pushing is one copy,
+ *          and encoding writes into a caller buffer of
+ *          FALL_CAPTURE_TEXT_MAX.
+ *
+ *          One task pushes and triggers, another may encode and release
+ *          once fall_capture_frozen(): a frozen ring is not written.
+ *          Later triggers are ignored until then, the first fall is the
+ *          one kept.
+ */
+typedef struct {
+    int16_t ring[FALL_CAPTURE_LEN][FALL_CAPTURE_AXES];
+    uint32_t n;                     // Samples pushed (ring slot = n % FALL_CAPTURE_LEN)
+    uint32_t start;                 // Sample number of the first one since the last freeze
+    bool dropped;                   // Samples were pushed while frozen
+    volatile bool gap;              // fall_capture_gap() since the last push
+    uint32_t first;                 // Sample number of the first captured sample
+    uint32_t trigger;               // Sample number of the trigger
+    int64_t t_trigger_us;
+    volatile fall_capture_state_t state;
+} fall_capture_t;
+
+/**
+ * @brief Empty the ring and start recording
+ */
+void fall_capture_init(fall_capture_t *c);
+
+/**
+ * @brief Push one sample (ignored while frozen)
+ * @param s ax, ay, az, gx, gy, gz in sensor counts
+ */
+void fall_capture_push(fall_capture_t *c, const int16_t s[FALL_CAPTURE_AXES]);
+
+/**
+ * @brief The stream broke (sensor idled, FIFO restarted)
+ * @details Samples pushed from now on are not contiguous with the ones
+ *          before, so a later capture starts at the next push. Only sets
+ *          a flag, so the task that restarts the stream may call it, as
+ *          long as no sample from before the break is still to be pushed.
+ */
+void fall_capture_gap(fall_capture_t *c);
+
+/**
+ * @brief Mark the last pushed sample as the trigger
+ * @param t_us Time of that sample
+ * @return false if a capture is already under way or waiting to be sent
+ */
+bool fall_capture_trigger(fall_capture_t *c, int64_t t_us);
+
+/**
+ * @brief The post-trigger window is complete and the ring is frozen
+ */
+bool fall_capture_frozen(const fall_capture_t *c);
+
+/**
+ * @brief Samples of a frozen capture, and how many of them precede the trigger
+ */
+uint32_t fall_capture_count(const fall_capture_t *c, uint32_t *pre);
+
+/**
+ * @brief Encode a frozen capture as text
+ * @details Samples in order, the six values of each interleaved. Every
+ *          value is stored as its difference from the same axis in the
+ *          previous sample (the first from 0), zigzag-mapped and written
+ *          as a little-endian base-128 varint; the byte stream is then
+ *          base64 (RFC 4648, padded) so it fits in a JSON string. A still
+ *          wearer costs about one byte per value instead of two.
+ * @return Text length (terminator excluded), 0 if not frozen or cap is
+ *         too small
+ */
+size_t fall_capture_encode(const fall_capture_t *c, char *out, size_t cap);
+
+/**
+ * @brief Decode fall_capture_encode() text
+ * @return Samples written to out (at most max), 0 on malformed text
+ */
+size_t fall_capture_decode(const char *text, int16_t (*out)[FALL_CAPTURE_AXES], size_t max);
+
+/**
+ * @brief Drop a frozen capture and record again
+ */
+void fall_capture_release(fall_capture_t *c);
+
+#endif
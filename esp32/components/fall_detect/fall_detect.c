@@ -0,0 +1,262 @@
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include "fall_detect.h"
+
+#define NO_LIMIT        SIZE_MAX    // Window offset of a state without that bound
+
+
+typedef bool (*fall_cond_t)(const fall_detect_t *d, const fall_detect_config_t *c);
+
+/*
+ * One row per state. The exit condition is tested first, then the
+ * windows: leaving before min_ms or staying past max_ms goes back to
+ * idle. The windows are offsets of uint16_t fields in the config, so a
+ * new config applies to the state already running.
+ */
+typedef struct {
+	const char *name;
+	fall_cond_t exit;
+	fall_state_t next;
+	size_t min_ms;
+	size_t max_ms;
+	bool confirms;          // Taking the exit is a fall
+} fall_row_t;
+
+
+// A threshold as a squared magnitude in sample counts
+static uint32_t squared_counts(float value, float lsb_per_unit)
+{
+	float x = value * lsb_per_unit;
+	return (x * x >= 4294967295.0f) ? UINT32_MAX : (uint32_t)(x * x);
+}
+
+
+static uint32_t magnitude2(const int16_t v[3])
+{
+	// Each square fits in 30 bits, the sum of three in 32
+	return (uint32_t)(v[0] * v[0]) + (uint32_t)(v[1] * v[1]) + (uint32_t)(v[2] * v[2]);
+}
+
+
+static bool still(const fall_detect_t *d, const fall_detect_config_t *c)
+{
+	return d->gyro2 < squared_counts(c->post_inact_dps, FALL_GYRO_LSB_PER_DPS);
+}
+
+
+static bool in_free_fall(const fall_detect_t *d, const fall_detect_config_t *c)
+{
+	return d->acc2 < squared_counts(c->ff_g, FALL_ACC_LSB_PER_G);
+}
+
+
+static bool free_fall_ended(const fall_detect_t *d, const fall_detect_config_t *c)
+{
+	return !in_free_fall(d, c);
+}
+
+
+static bool impact(const fall_detect_t *d, const fall_detect_config_t *c)
+{
+	return d->acc2 > squared_counts(c->impact_g, FALL_ACC_LSB_PER_G);
+}
+
+
+// Still but upright (caught themselves, sat down) keeps watching
+static bool lying_still(const fall_detect_t *d, const fall_detect_config_t *c)
+{
+	return still(d, c) &&
+	       imu_fusion_posture(&d->fusion, c->upright_axis, c->post_angle_deg) == IMU_POSTURE_LYING;
+}
+
+
+static const fall_row_t k_rows[FALL_ST_COUNT] = {
+	[FALL_ST_IDLE] = {
+		"IDLE", in_free_fall, FALL_ST_FREE_FALL, NO_LIMIT, NO_LIMIT, false,
+	},
+	[FALL_ST_FREE_FALL] = {
+		"FREE_FALL", free_fall_ended, FALL_ST_IMPACT_WAIT,
+		offsetof(fall_detect_config_t, ff_min_ms), offsetof(fall_detect_config_t, ff_max_ms), false,
+	},
+	[FALL_ST_IMPACT_WAIT] = {
+		"IMPACT_WAIT", impact, FALL_ST_POST_MONITOR,
+		NO_LIMIT, offsetof(fall_detect_config_t, impact_timeout_ms), false,
+	},
+	[FALL_ST_POST_MONITOR] = {
+		"POST_MONITOR", lying_still, FALL_ST_IDLE,
+		NO_LIMIT, offsetof(fall_detect_config_t, post_window_ms), true,
+	},
+};
+
+static const fall_detect_config_t k_default = {
+	.version = FALL_CONFIG_VERSION,
+	.upright_axis = FALL_UPRIGHT_AXIS,
+	.ff_min_ms = FALL_FF_MIN_MS,
+	.ff_max_ms = FALL_FF_MAX_MS,
+	.impact_timeout_ms = FALL_IMPACT_TIMEOUT_MS,
+	.post_window_ms = FALL_POST_WINDOW_MS,
+	.cooldown_ms = FALL_COOLDOWN_MS,
+	.ff_g = FALL_FF_G,
+	.impact_g = FALL_IMPACT_G,
+	.post_inact_dps = FALL_POST_INACT_DPS,
+	.post_angle_deg = FALL_POST_ANGLE_DEG,
+};
+
+static fall_detect_config_t s_slots[2];
+static const fall_detect_config_t *volatile s_active = &k_default;
+
+
+static int64_t window_ms(const fall_detect_config_t *c, size_t offset)
+{
+	uint16_t ms;
+	memcpy(&ms, (const uint8_t *)c + offset, sizeof(ms));
+	return ms;
+}
+
+
+void fall_detect_default_config(fall_detect_config_t *c)
+{
+	*c = k_default;
+}
+
+
+bool fall_detect_validate(const fall_detect_config_t *c)
+{
+	if (c->version != FALL_CONFIG_VERSION || c->upright_axis > 2) {
+		return false;
+	}
+	if (c->ff_max_ms == 0 || c->ff_min_ms > c->ff_max_ms ||
+	    c->impact_timeout_ms == 0 || c->post_window_ms == 0) {
+		return false;
+	}
+	// The negated tests also reject NaN
+	return (c->ff_g > 0.0f && c->ff_g < 1.0f) && (c->impact_g > c->ff_g) &&
+	       (c->post_inact_dps > 0.0f) && (c->post_angle_deg > 0.0f && c->post_angle_deg < 90.0f);
+}
+
+
+bool fall_detect_set_config(const fall_detect_config_t *c)
+{
+	if (!fall_detect_validate(c)) {
+		return false;
+	}
+
+	fall_detect_config_t *slot = (s_active == &s_slots[0]) ? &s_slots[1] : &s_slots[0];
+	*slot = *c;
+	s_active = slot;
+	return true;
+}
+
+
+const fall_detect_config_t *fall_detect_config(void)
+{
+	return s_active;
+}
+
+
+uint32_t fall_detect_span_ms(const fall_detect_config_t *c)
+{
+	return (uint32_t)c->ff_max_ms + c->impact_timeout_ms + c->post_window_ms;
+}
+
+
+void fall_detect_init(fall_detect_t *d)
+{
+	memset(d, 0, sizeof(*d));
+	d->state = FALL_ST_IDLE;
+	imu_fusion_init(&d->fusion);
+	fall_features_init(&d->features);
+}
+
+
+void fall_detect_gap(fall_detect_t *d)
+{
+	d->gap = true;
+}
+
+
+// One report per cooldown, whichever path confirms
+static bool report(fall_detect_t *d, const fall_detect_config_t *c, int64_t now, fall_source_t source)
+{
+	if (d->reported && now - d->t_report_ms <= c->cooldown_ms) {
+		return false;
+	}
+	d->reported = true;
+	d->t_report_ms = now;
+	d->source = source;
+	return true;
+}
+
+
+bool fall_detect_process(fall_detect_t *d, int64_t t_us, const int16_t acc[3], const int16_t gyro[3])
+{
+	const fall_detect_config_t *c = s_active;
+	const fall_row_t *row = &k_rows[d->state];
+	// Sample time, not processing time: FIFO samples arrive in batches
+	const int64_t now = t_us / 1000;
+	const int64_t elapsed = now - d->t_state_ms;
+	fall_state_t next = d->state;
+	bool fall = false;
+	float up[3];
+
+	const float g = 1.0f / FALL_ACC_LSB_PER_G;
+	const float dps = 1.0f / FALL_GYRO_LSB_PER_DPS;
+
+	if (d->gap) {
+		d->gap = false;
+		fall_features_init(&d->features);
+	}
+
+	d->acc2 = magnitude2(acc);
+	d->gyro2 = magnitude2(gyro);
+	imu_fusion_update(&d->fusion, t_us, gyro[0] * dps, gyro[1] * dps, gyro[2] * dps,
+	                  acc[0] * g, acc[1] * g, acc[2] * g);
+	imu_fusion_vertical(&d->fusion, up);
+	fall_features_push(&d->features, sqrtf((float)d->acc2) * g, up);
+
+	if (row->exit(d, c)) {
+		if (row->min_ms != NO_LIMIT && elapsed < window_ms(c, row->min_ms)) {
+			next = FALL_ST_IDLE;
+		} else {
+			next = row->next;
+			fall = row->confirms && report(d, c, now, FALL_SOURCE_STATE_MACHINE);
+		}
+	} else if (row->max_ms != NO_LIMIT && elapsed > window_ms(c, row->max_ms)) {
+		next = FALL_ST_IDLE;
+	}
+
+	if (next != d->state) {
+		d->state = next;
+		d->t_state_ms = now;
+	}
+
+	// Classifier at rest between state machine runs
+	const fall_model_t *m = fall_model_get();
+	d->scored = !fall && next == FALL_ST_IDLE && m->enabled &&
+	            still(d, c) && fall_features_ready(&d->features);
+	if (d->scored) {
+		fall_features_compute(&d->features, c->upright_axis, d->feat);
+		d->verdict = fall_model_classify(m, d->feat);
+		fall = d->verdict && report(d, c, now, FALL_SOURCE_CLASSIFIER);
+	}
+	return fall;
+}
+
+
+float fall_detect_acc_g(const fall_detect_t *d)
+{
+	return sqrtf((float)d->acc2) / FALL_ACC_LSB_PER_G;
+}
+
+
+float fall_detect_gyro_dps(const fall_detect_t *d)
+{
+	return sqrtf((float)d->gyro2) / FALL_GYRO_LSB_PER_DPS;
+}
+
+
+const char *fall_detect_state_name(fall_state_t s)
+{
+	return (s < FALL_ST_COUNT) ? k_rows[s].name : "UNKNOWN";
+}
@@ -0,0 +1,174 @@
+#ifndef FALL_DETECT_H
+#define FALL_DETECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "imu_fusion.h"
+#include "fall_features.h"
+#include "fall_model.h"
+
+#define FALL_CONFIG_VERSION         1       // Layout of fall_detect_config_t (NVS blob)
+#define FALL_ACC_LSB_PER_G          16384.0f    // Sample counts per g, as MPU6050_ACCEL_LSB_PER_G
+#define FALL_GYRO_LSB_PER_DPS       65.5f       // Sample counts per °/s, as MPU6050_GYRO_LSB_PER_DPS
+
+// Defaults of fall_detect_config_t (adjust based on testing)
+#define FALL_FF_G                   0.35f   // Free-fall threshold (g)
+#define FALL_FF_MIN_MS              120     // Minimum free-fall duration (ms)
+#define FALL_FF_MAX_MS              1000    // Maximum free-fall before impact (ms)
+#define FALL_IMPACT_G               1.0f    // Impact threshold (g)
+#define FALL_IMPACT_TIMEOUT_MS      300     // Time window to detect impact after FF
+#define FALL_POST_INACT_DPS         10.0f   // Gyro inactivity threshold (dps)
+#define FALL_POST_ANGLE_DEG         45.0f   // Tilt of the upright axis from vertical above which the wearer is lying
+#define FALL_UPRIGHT_AXIS           0       // Sensor axis pointing up when the wearer stands (0 = X, 1 = Y, 2 = Z)
+#define FALL_POST_WINDOW_MS         1500    // Post-impact monitoring window (ms)
+#define FALL_COOLDOWN_MS            3000    // Prevent duplicate reports
+
+/**
+ * @brief Fall detection states
+ */
+typedef enum {
+    FALL_ST_IDLE = 0,       // Normal state
+    FALL_ST_FREE_FALL,      // Free-fall detected
+    FALL_ST_IMPACT_WAIT,    // Waiting for impact
+    FALL_ST_POST_MONITOR,   // Monitoring post-impact posture
+    FALL_ST_COUNT
+} fall_state_t;
+
+/**
+ * @brief What confirmed a fall
+ */
+typedef enum {
+    FALL_SOURCE_STATE_MACHINE = 0,  // Free-fall, impact, lying still
+    FALL_SOURCE_CLASSIFIER,         // Window features through the fall_model_t tree
+} fall_source_t;
+
+/**
+ * @brief Thresholds and windows of the detector
+ * @details Stored as-is in NVS, so any layout change must bump
+ *          FALL_CONFIG_VERSION.
+ */
+typedef struct {
+    uint8_t version;            // FALL_CONFIG_VERSION
+    uint8_t upright_axis;       // FALL_UPRIGHT_AXIS
+    uint16_t ff_min_ms;         // FALL_FF_MIN_MS
+    uint16_t ff_max_ms;         // FALL_FF_MAX_MS
+    uint16_t impact_timeout_ms; // FALL_IMPACT_TIMEOUT_MS
+    uint16_t post_window_ms;    // FALL_POST_WINDOW_MS
+    uint16_t cooldown_ms;       // FALL_COOLDOWN_MS
+    float ff_g;                 // FALL_FF_G
+    float impact_g;             // FALL_IMPACT_G
+    float post_inact_dps;       // FALL_POST_INACT_DPS
+    float post_angle_deg;       // FALL_POST_ANGLE_DEG
+} fall_detect_config_t;
+
+/**
+ * @brief Free-fall -> impact -> lying still detector
+ * @details One row per state in a transition table: the condition that
+ *          leaves it, where it goes, and the config windows that bound
+ *          it (leaving before the minimum or staying past the maximum
+ *          returns to idle). The orientation filter runs on every sample
+ *          so the posture is current when the post-impact state needs it.
+ *
+ *          Alongside it, the decision tree of fall_model.h classifies
+ *          the window features whenever the state machine is idle and
+ *          the wearer is still. That catches falls without a free-fall
+ *          phase (slumping from a chair): a fall ends at rest, and the
+ *          window then holds the movement that led there. Both paths
+ *          share the cooldown.
+ *
+ *          Samples come in as the sensor's int16 counts. The thresholds
+ *          are compared with squared magnitudes in those units, so the
+ *          state machine takes no square root; only the feature window
+ *          needs |a| itself.
+ *
+ *          Plain C without ESP-IDF, so tools/fall_replay runs the same
+ *          code on recorded traces.
+ */
+typedef struct {
+    fall_state_t state;
+    int64_t t_state_ms;         // Sample time the state was entered
+    int64_t t_report_ms;        // Last confirmed fall
+    bool reported;              // t_report_ms is valid
+    fall_source_t source;       // Path of the last confirmed fall
+    uint32_t acc2;              // Squared magnitudes of the last sample (counts²)
+    uint32_t gyro2;
+    bool scored;                // The classifier ran on the last sample...
+    int32_t feat[FALL_FEAT_COUNT];  // ...on these features
+    bool verdict;               // ...and found a fall
+    volatile bool gap;          // fall_detect_gap() since the last sample
+    imu_fusion_t fusion;
+    fall_features_t features;
+} fall_detect_t;
+
+/**
+ * @brief Built-in thresholds, the FALL_* defaults
+ */
+void fall_detect_default_config(fall_detect_config_t *c);
+
+/**
+ * @brief Check a config before it is applied or stored
+ * @return false on a wrong version, an axis above 2, thresholds out of
+ *         order (free-fall below impact, minimum above maximum) or a
+ *         non-positive / NaN value
+ */
+bool fall_detect_validate(const fall_detect_config_t *c);
+
+/**
+ * @brief Make a config the active one
+ * @details Copied to the inactive one of two slots and swapped in with a
+ *          single pointer store, so the detector never reads a
+ *          half-written config; it picks it up at the next sample.
+ * @return false (active config unchanged) if it does not validate
+ */
+bool fall_detect_set_config(const fall_detect_config_t *c);
+
+/**
+ * @brief Active config (the defaults until fall_detect_set_config() succeeds)
+ */
+const fall_detect_config_t *fall_detect_config(void);
+
+/**
+ * @brief Longest a fall takes from the first free-fall sample to confirmation (ms)
+ */
+uint32_t fall_detect_span_ms(const fall_detect_config_t *c);
+
+/**
+ * @brief Reset to idle with an empty orientation and feature window
+ */
+void fall_detect_init(fall_detect_t *d);
+
+/**
+ * @brief The stream broke (sensor idled, FIFO restarted)
+ * @details The feature window starts empty at the next sample, so no
+ *          feature (FALL_FEAT_ORIENT above all) spans the break. Only sets
+ *          a flag, so the task that restarts the stream may call it, as
+ *          long as no sample from before the break is still to be processed.
+ */
+void fall_detect_gap(fall_detect_t *d);
+
+/**
+ * @brief Run one IMU sample through the state machine
+ * @param t_us Sample time
+ * @param acc  Acceleration (FALL_ACC_LSB_PER_G counts, mpu6050_raw_t.accel)
+ * @param gyro Angular rate (FALL_GYRO_LSB_PER_DPS counts, mpu6050_raw_t.gyro)
+ * @return true when a fall is confirmed by either path (at most one per
+ *         cooldown, d->source tells which)
+ */
+bool fall_detect_process(fall_detect_t *d, int64_t t_us, const int16_t acc[3], const int16_t gyro[3]);
+
+/**
+ * @brief Acceleration magnitude of the last sample (g), for logs
+ */
+float fall_detect_acc_g(const fall_detect_t *d);
+
+/**
+ * @brief Angular rate magnitude of the last sample (°/s), for logs
+ */
+float fall_detect_gyro_dps(const fall_detect_t *d);
+
+/**
+ * @brief State name for logs
+ */
+const char *fall_detect_state_name(fall_state_t s);
+
+#endif
@@ -0,0 +1,109 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fall_features.h"
+
+#define ONE_G_MG        1000
+#define RAD2DEG         (180.0f / 3.14159265f)
+
+
+static int16_t clamp_i16(float v)
+{
+	return (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+}
+
+
+static int32_t deviation(int16_t mag)
+{
+	return abs(mag - ONE_G_MG);
+}
+
+
+static float acos_deg(float c)
+{
+	c = (c > 1.0f) ? 1.0f : (c < -1.0f) ? -1.0f : c;
+	return acosf(c) * RAD2DEG;
+}
+
+
+void fall_features_init(fall_features_t *f)
+{
+	memset(f, 0, sizeof(*f));
+}
+
+
+void fall_features_push(fall_features_t *f, float acc_g, const float up[3])
+{
+	fall_feat_sample_t s;
+	s.mag = clamp_i16(acc_g * ONE_G_MG + 0.5f);
+	s.jerk = (f->n > 0) ? clamp_i16((float)abs(s.mag - f->prev_mag)) : 0;
+	for (int i = 0; i < 3; i++) {
+		s.up[i] = clamp_i16(up[i] * FALL_FEAT_UP_ONE);
+	}
+	f->prev_mag = s.mag;
+
+	uint16_t slot = f->n % FALL_FEAT_WINDOW;
+	if (f->n >= FALL_FEAT_WINDOW) {
+		// The sample leaving the window is the one in this slot
+		const fall_feat_sample_t *old = &f->ring[slot];
+		f->sum_dev -= deviation(old->mag);
+		f->sum_jerk -= old->jerk;
+		f->sum_mag -= old->mag;
+		f->sum_mag2 -= (int32_t)old->mag * old->mag;
+
+		if (f->peak_len > 0 && f->peak[f->peak_head] + FALL_FEAT_WINDOW <= f->n) {
+			f->peak_head = (f->peak_head + 1) % FALL_FEAT_WINDOW;
+			f->peak_len--;
+		}
+	}
+
+	f->ring[slot] = s;
+	f->sum_dev += deviation(s.mag);
+	f->sum_jerk += s.jerk;
+	f->sum_mag += s.mag;
+	f->sum_mag2 += (int32_t)s.mag * s.mag;
+
+	// Smaller samples before this one can never be the peak again
+	while (f->peak_len > 0) {
+		uint32_t back = f->peak[(f->peak_head + f->peak_len - 1) % FALL_FEAT_WINDOW];
+		if (f->ring[back % FALL_FEAT_WINDOW].mag > s.mag) {
+			break;
+		}
+		f->peak_len--;
+	}
+	f->peak[(f->peak_head + f->peak_len) % FALL_FEAT_WINDOW] = f->n;
+	f->peak_len++;
+	f->n++;
+}
+
+
+bool fall_features_ready(const fall_features_t *f)
+{
+	return f->n >= FALL_FEAT_WINDOW;
+}
+
+
+void fall_features_compute(const fall_features_t *f, int upright_axis, int32_t x[FALL_FEAT_COUNT])
+{
+	int32_t count = (f->n < FALL_FEAT_WINDOW) ? (int32_t)f->n : FALL_FEAT_WINDOW;
+	if (count == 0) {
+		memset(x, 0, FALL_FEAT_COUNT * sizeof(*x));
+		return;
+	}
+
+	const fall_feat_sample_t *now = &f->ring[(f->n - 1) % FALL_FEAT_WINDOW];
+	const fall_feat_sample_t *oldest = &f->ring[(f->n - count) % FALL_FEAT_WINDOW];
+	int64_t var_n2 = (int64_t)count * f->sum_mag2 - f->sum_mag * f->sum_mag;
+	int32_t dot = 0;
+	for (int i = 0; i < 3; i++) {
+		dot += (int32_t)now->up[i] * oldest->up[i];
+	}
+	int axis = (upright_axis >= 0 && upright_axis < 3) ? upright_axis : 2;
+
+	x[FALL_FEAT_SMA] = f->sum_dev / count;
+	x[FALL_FEAT_JERK] = (int32_t)((int64_t)f->sum_jerk * FALL_FEAT_RATE_HZ / count);
+	x[FALL_FEAT_STD] = (var_n2 > 0) ? (int32_t)(sqrtf((float)var_n2) / count) : 0;
+	x[FALL_FEAT_PEAK] = f->ring[f->peak[f->peak_head] % FALL_FEAT_WINDOW].mag;
+	x[FALL_FEAT_ORIENT] = (int32_t)acos_deg((float)dot / ((float)FALL_FEAT_UP_ONE * FALL_FEAT_UP_ONE));
+	x[FALL_FEAT_TILT] = (int32_t)acos_deg(fabsf((float)now->up[axis] / FALL_FEAT_UP_ONE));
+}
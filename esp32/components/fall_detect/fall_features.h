@@ -0,0 +1,77 @@
+#ifndef FALL_FEATURES_H
+#define FALL_FEATURES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FALL_FEAT_RATE_HZ   100     // Sample rate the window and jerk are scaled for
+#define FALL_FEAT_WINDOW    200     // Samples in the sliding window (2 s)
+#define FALL_FEAT_UP_ONE    16384   // Unit vertical in the ring (Q14)
+
+/**
+ * @brief Features of the last FALL_FEAT_WINDOW samples, all integers
+ */
+typedef enum {
+    FALL_FEAT_SMA = 0,      // Signal magnitude area: mean of | |a| - 1 g | (mg)
+    FALL_FEAT_JERK,         // Mean of | d|a|/dt | (mg/s)
+    FALL_FEAT_STD,          // Standard deviation of |a| (mg)
+    FALL_FEAT_PEAK,         // Largest |a| (mg)
+    FALL_FEAT_ORIENT,       // Rotation of the vertical from the oldest sample to now (deg)
+    FALL_FEAT_TILT,         // Tilt of the upright axis now (deg)
+    FALL_FEAT_COUNT
+} fall_feature_t;
+
+typedef struct {
+    int16_t mag;            // |a| (mg)
+    int16_t jerk;           // | |a| - previous |a| | (mg)
+    int16_t up[3];          // Vertical in the sensor frame (FALL_FEAT_UP_ONE = 1)
+} fall_feat_sample_t;
+
+/**
+ * @brief Sliding-window feature extractor
+ * @details Every per-sample update is O(1): the sums behind SMA, jerk and
+ *          variance are updated by the sample entering and the one leaving
+ *          the ring, and the peak comes from a monotonic queue (amortised
+ *          O(1), each sample is pushed and popped at most once). Magnitudes
+ *          are kept in mg as int16 and summed in integers, so the sums do
+ *          not drift however long the stream runs. fall_features_compute()
+ *          reads them in constant time too (two acosf, one square root).
+ */
+typedef struct {
+    fall_feat_sample_t ring[FALL_FEAT_WINDOW];
+    uint32_t n;                         // Samples pushed (ring slot = n % FALL_FEAT_WINDOW)
+    int16_t prev_mag;
+    int32_t sum_dev;                    // Sum of | |a| - 1 g |
+    int32_t sum_jerk;
+    int64_t sum_mag;
+    int64_t sum_mag2;
+    uint32_t peak[FALL_FEAT_WINDOW];    // Sample numbers, |a| decreasing from the front
+    uint16_t peak_head;
+    uint16_t peak_len;
+} fall_features_t;
+
+/**
+ * @brief Empty the window
+ */
+void fall_features_init(fall_features_t *f);
+
+/**
+ * @brief Push one sample
+ * @param acc_g Acceleration magnitude (g)
+ * @param up    Vertical in the sensor frame (unit vector, imu_fusion_vertical())
+ */
+void fall_features_push(fall_features_t *f, float acc_g, const float up[3]);
+
+/**
+ * @brief The window is full (features cover FALL_FEAT_WINDOW samples)
+ */
+bool fall_features_ready(const fall_features_t *f);
+
+/**
+ * @brief Features of the current window
+ * @param upright_axis Sensor axis pointing up when the wearer stands
+ * @param x            Output, indexed by fall_feature_t
+ */
+void fall_features_compute(const fall_features_t *f, int upright_axis, int32_t x[FALL_FEAT_COUNT]);
+
+#endif
@@ -0,0 +1,77 @@
+#include "fall_model.h"
+
+#define TEST(f, t, b, a)    {.feature = (f), .below = (b), .above = (a), .threshold = (t)}
+#define LEAF(c)             {.feature = FALL_MODEL_LEAF, .threshold = (c)}
+
+static const fall_model_t k_default = {
+	.version = FALL_MODEL_VERSION,
+	.enabled = 1,
+	.count = 7,
+	.node = {
+		TEST(FALL_FEAT_TILT, 45, 1, 2),
+		LEAF(0),
+		TEST(FALL_FEAT_ORIENT, 45, 3, 4),
+		LEAF(0),
+		TEST(FALL_FEAT_PEAK, 1300, 5, 6),
+		LEAF(0),
+		LEAF(1),
+	},
+};
+
+static fall_model_t s_slots[2];
+static const fall_model_t *volatile s_active = &k_default;
+
+
+void fall_model_default(fall_model_t *m)
+{
+	*m = k_default;
+}
+
+
+bool fall_model_validate(const fall_model_t *m)
+{
+	if (m->version != FALL_MODEL_VERSION || m->count == 0 || m->count > FALL_MODEL_MAX_NODES) {
+		return false;
+	}
+	for (int i = 0; i < m->count; i++) {
+		const fall_node_t *n = &m->node[i];
+		if (n->feature == FALL_MODEL_LEAF) {
+			if (n->threshold != 0 && n->threshold != 1) {
+				return false;
+			}
+		} else if (n->feature >= FALL_FEAT_COUNT || n->below <= i || n->above <= i ||
+		           n->below >= m->count || n->above >= m->count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool fall_model_set(const fall_model_t *m)
+{
+	if (!fall_model_validate(m)) {
+		return false;
+	}
+
+	fall_model_t *slot = (s_active == &s_slots[0]) ? &s_slots[1] : &s_slots[0];
+	*slot = *m;
+	s_active = slot;
+	return true;
+}
+
+
+const fall_model_t *fall_model_get(void)
+{
+	return s_active;
+}
+
+
+bool fall_model_classify(const fall_model_t *m, const int32_t x[FALL_FEAT_COUNT])
+{
+	const fall_node_t *n = &m->node[0];
+	while (n->feature != FALL_MODEL_LEAF) {
+		n = &m->node[(x[n->feature] < n->threshold) ? n->below : n->above];
+	}
+	return n->threshold != 0;
+}
@@ -0,0 +1,73 @@
+#ifndef FALL_MODEL_H
+#define FALL_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fall_features.h"
+
+#define FALL_MODEL_VERSION      1       // Layout of fall_model_t (NVS blob)
+#define FALL_MODEL_MAX_NODES    15      // A full tree of depth 4
+#define FALL_MODEL_LEAF         0xFF    // fall_node_t.feature of a leaf
+
+/**
+ * @brief One node of the decision tree
+ */
+typedef struct {
+    uint8_t feature;        // fall_feature_t tested, FALL_MODEL_LEAF for a leaf
+    uint8_t below;          // Next node when x[feature] < threshold
+    uint8_t above;          // Next node otherwise
+    uint8_t reserved;
+    int32_t threshold;      // In the units of the feature; a leaf holds its class (1 = fall)
+} fall_node_t;
+
+/**
+ * @brief Decision tree over the window features, integer compares only
+ * @details Node 0 is the root and children always come after their
+ *          parent, so a walk ends in at most FALL_MODEL_MAX_NODES steps.
+ *          A tree trained offline (on the fall_replay --features dump) is
+ *          flattened into this array. The struct is stored as-is in NVS,
+ *          so any layout change must bump FALL_MODEL_VERSION.
+ */
+typedef struct {
+    uint8_t version;                    // FALL_MODEL_VERSION
+    uint8_t enabled;                    // 0 = state machine only
+    uint8_t count;                      // Nodes in use
+    uint8_t reserved;
+    fall_node_t node[FALL_MODEL_MAX_NODES];
+} fall_model_t;
+
+/**
+ * @brief Built-in tree: tilted beyond 45°, turned by 45° or more within
+ *        the window and a jolt above 1.3 g
+ * @details Lying down or bending over on purpose turns as far but
+ *          without the jolt; a jump or a hard sit has the jolt but ends
+ *          upright.
+ */
+void fall_model_default(fall_model_t *m);
+
+/**
+ * @brief Check a tree before it is applied or stored
+ * @return false on a wrong version or node count, a feature out of
+ *         range, a child not after its parent or past count, or a leaf
+ *         class other than 0 / 1
+ */
+bool fall_model_validate(const fall_model_t *m);
+
+/**
+ * @brief Make a tree the active one (two slots, swapped in one store)
+ * @return false (active tree unchanged) if it does not validate
+ */
+bool fall_model_set(const fall_model_t *m);
+
+/**
+ * @brief Active tree (the built-in one until fall_model_set() succeeds)
+ */
+const fall_model_t *fall_model_get(void);
+
+/**
+ * @brief Walk the tree for a feature vector
+ * @return true for a fall
+ */
+bool fall_model_classify(const fall_model_t *m, const int32_t x[FALL_FEAT_COUNT]);
+
+#endif
@@ -3,6 +3,7 @@
 #include "nvs_stoarge.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "task_map.h"
 #include "cJSON.h"
 #include <string.h>
 
@@ -198,6 +199,9 @@ esp_err_t http_server_start(system_mode_t mode)
     // Configure HTTP server
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable = true;
+    config.task_priority = task_map_priority(TASK_HTTPD);
+    config.core_id = task_map_core(TASK_HTTPD);
+    config.stack_size = task_map_get(TASK_HTTPD)->stack;
 
     ESP_LOGI(TAG, "Starting HTTP server in %s mode...", 
              mode == SYS_MODE_AP_SIMPLE ? "Simple" : "Full");
@@ -6,7 +6,9 @@
 #include "esp_http_client.h"
 #include "esp_https_ota.h"
 #include "esp_crt_bundle.h"
+#include "task_map.h"
 #include <stdio.h>
+#include <string.h>
 
 static const char *TAG = "MQTT_CLIENT";
 
@@ -15,6 +17,13 @@ extern EventGroupHandle_t g_event_group;
 static char s_access_token[TOKEN_MAX_LEN] = {0};
 static bool s_ota_in_progress = false;
 
+// Shared attributes handled outside this component (mqtt_register_attribute)
+static struct {
+    const char *key;
+    mqtt_attr_cb_t cb;
+} s_attr_handlers[MQTT_ATTR_CB_MAX];
+static int s_attr_handler_count = 0;
+
 static char *server_cert = 
 "-----BEGIN CERTIFICATE-----\n"
 "MIIFBjCCAu6gAwIBAgIRAIp9PhPWLzDvI4a9KQdrNPgwDQYJKoZIhvcNAQELBQAw\n"
@@ -148,6 +157,35 @@ static void ota_execution_task(void *param){
     vTaskDelete(NULL);
 }
 
+/**
+ * @brief Hand registered shared attributes to their handlers
+ * @param data Attribute JSON (update push or request response)
+ * @param len Length of data
+ */
+static void dispatch_attributes(const char *data, int len) {
+    if (s_attr_handler_count == 0) {
+        return;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGW(TAG, "Attribute JSON parse error");
+        return;
+    }
+
+    // Responses nest shared attributes under "shared", pushes do not
+    cJSON *shared = cJSON_GetObjectItemCaseSensitive(root, "shared");
+    cJSON *target_node = shared ? shared : root;
+
+    for (int i = 0; i < s_attr_handler_count; i++) {
+        cJSON *value = cJSON_GetObjectItemCaseSensitive(target_node, s_attr_handlers[i].key);
+        if (value) {
+            s_attr_handlers[i].cb(value);
+        }
+    }
+    cJSON_Delete(root);
+}
+
 /**
  * @brief OTA scheduler task - periodically checks for firmware updates
  * @param param Unused
@@ -162,9 +200,20 @@ static void ota_scheduler_task(void *param) {
         if (mqtt_is_connected() && !s_ota_in_progress) {
             ESP_LOGI(TAG, "Checking for firmware updates...");
             
-            // Request shared attributes: fw_title and fw_version
-            const char *req = "{\"sharedKeys\":\"fw_title,fw_version\"}";
-            esp_mqtt_client_publish(mqtt_client, ATTR_REQUEST_TOPIC, req, 0, 1, 0);
+            // Request shared attributes: fw_title, fw_version and the registered keys
+            char req[192];
+            int len = snprintf(req, sizeof(req), "{\"sharedKeys\":\"fw_title,fw_version");
+            for (int i = 0; i < s_attr_handler_count && len < (int)sizeof(req); i++) {
+                len += snprintf(req + len, sizeof(req) - len, ",%s", s_attr_handlers[i].key);
+            }
+            if (len < (int)sizeof(req)) {
+                len += snprintf(req + len, sizeof(req) - len, "\"}");
+            }
+            if (len < (int)sizeof(req)) {
+                esp_mqtt_client_publish(mqtt_client, ATTR_REQUEST_TOPIC, req, 0, 1, 0);
+            } else {
+                ESP_LOGE(TAG, "Attribute request too long");
+            }
         } else if (s_ota_in_progress) {
             ESP_LOGI(TAG, "OTA in progress, skipping check");
         }
@@ -191,6 +240,10 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                 xEventGroupSetBits(g_event_group, MQTT_CONNECTED_BIT);
                 // Subscribe to attribute response topic for OTA
                 esp_mqtt_client_subscribe(mqtt_client, ATTR_RESPONSE_TOPIC, 1);
+                // Shared attribute updates pushed by the server
+                if (s_attr_handler_count > 0) {
+                    esp_mqtt_client_subscribe(mqtt_client, ATTRIBUTES_TOPIC, 1);
+                }
             }
             break;
 
@@ -211,6 +264,8 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
             
             // Check if this is an attribute response (for OTA)
             if (strncmp(event->topic, "v1/devices/me/attributes/response", 33) == 0) {
+                dispatch_attributes(event->data, event->data_len);
+
                 // Copy JSON data
                 char *json = (char*)malloc(event->data_len + 1);
                 if (json) {
@@ -219,12 +274,17 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                     
                     // Create OTA execution task if not already in progress
                     if (!s_ota_in_progress) {
-                        xTaskCreate(ota_execution_task, "ota_exec", 
-                                    8192, (void*)json, 5, NULL);
+                        if (task_map_create(TASK_OTA_EXEC, ota_execution_task,
+                                            (void*)json, NULL) != ESP_OK) {
+                            free(json);
+                        }
                     } else {
                         free(json);
                     }
                 }
+            } else if (event->topic_len == (int)strlen(ATTRIBUTES_TOPIC) &&
+                       strncmp(event->topic, ATTRIBUTES_TOPIC, event->topic_len) == 0) {
+                dispatch_attributes(event->data, event->data_len);
             }
             break;
 
@@ -289,10 +349,12 @@ esp_err_t mqtt_client_init(const char *token) {
  * @param spo2 Blood oxygen saturation (%)
  * @param temperature Body temperature (°C)
  * @param alarm_status Alarm status string
+ * @param include_ppg false leaves heartRate and SpO2 out
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t mqtt_publish_telemetry(int heart_rate, double spo2, 
-                                  float temperature, const char *alarm_status) {
+                                  float temperature, const char *alarm_status,
+                                  bool include_ppg) {
     // Check connection status
     if (!mqtt_client || !mqtt_is_connected()) {
         ESP_LOGW(TAG, "MQTT not connected, skipping publish");
@@ -301,9 +363,13 @@ esp_err_t mqtt_publish_telemetry(int heart_rate, double spo2,
 
     // Build JSON payload
     char payload[256];
+    char ppg[48] = "";
+    if (include_ppg) {
+        snprintf(ppg, sizeof(ppg), "\"heartRate\":%d,\"SpO2\":%.2f,", heart_rate, spo2);
+    }
     int len = snprintf(payload, sizeof(payload),
-        "{\"heartRate\":%d,\"SpO2\":%.2f,\"temperature\":%.2f,\"alarm\":\"%s\"}",
-        heart_rate, spo2, temperature, alarm_status ? alarm_status : "normal");
+        "{%s\"temperature\":%.2f,\"alarm\":\"%s\"}",
+        ppg, temperature, alarm_status ? alarm_status : "normal");
 
     if (len < 0 || len >= sizeof(payload)) {
         ESP_LOGE(TAG, "Failed to build telemetry payload");
@@ -322,6 +388,168 @@ esp_err_t mqtt_publish_telemetry(int heart_rate, double spo2,
     return ESP_OK;
 }
 
+/**
+ * @brief Publish heart rate variability telemetry to ThingsBoard
+ * @param sdnn_ms SDNN over the HRV horizon (ms)
+ * @param rmssd_ms RMSSD over the HRV horizon (ms)
+ * @param pnn50 Successive differences above 50 ms (%)
+ * @param rr_ms Most recent inter-beat interval (ms)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_hrv(float sdnn_ms, float rmssd_ms, float pnn50, int rr_ms) {
+    // Check connection status
+    if (!mqtt_client || !mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, skipping publish");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Build JSON payload
+    char payload[128];
+    int len = snprintf(payload, sizeof(payload),
+        "{\"sdnn\":%.1f,\"rmssd\":%.1f,\"pnn50\":%.1f,\"rrInterval\":%d}",
+        sdnn_ms, rmssd_ms, pnn50, rr_ms);
+
+    if (len < 0 || len >= sizeof(payload)) {
+        ESP_LOGE(TAG, "Failed to build HRV payload");
+        return ESP_FAIL;
+    }
+
+    // Publish message
+    int msg_id = esp_mqtt_client_publish(mqtt_client, TELEMETRY_TOPIC,
+                                         payload, 0, 1, 0);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish HRV");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "HRV published: %s", payload);
+    return ESP_OK;
+}
+
+/**
+ * @brief Publish the respiratory rate to ThingsBoard
+ * @param breaths_per_min Rate fused from the PPG respiratory modulations
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_resp_rate(float breaths_per_min) {
+    // Check connection status
+    if (!mqtt_client || !mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, skipping publish");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Build JSON payload
+    char payload[48];
+    int len = snprintf(payload, sizeof(payload), "{\"respRate\":%.1f}", breaths_per_min);
+
+    if (len < 0 || len >= sizeof(payload)) {
+        ESP_LOGE(TAG, "Failed to build respiratory rate payload");
+        return ESP_FAIL;
+    }
+
+    // Publish message
+    int msg_id = esp_mqtt_client_publish(mqtt_client, TELEMETRY_TOPIC,
+                                         payload, 0, 1, 0);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish respiratory rate");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Respiratory rate published: %s", payload);
+    return ESP_OK;
+}
+
+/**
+ * @brief Publish perfusion index, confidence and beat count to ThingsBoard
+ * @param perfusion_index IR AC/DC (%)
+ * @param confidence 0-100 score of the reading
+ * @param beats Accepted beat intervals in the window
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_ppg_quality(float perfusion_index, int confidence, int beats) {
+    // Check connection status
+    if (!mqtt_client || !mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, skipping publish");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Build JSON payload
+    char payload[96];
+    int len = snprintf(payload, sizeof(payload),
+        "{\"perfusionIndex\":%.2f,\"confidence\":%d,\"beats\":%d}",
+        perfusion_index, confidence, beats);
+
+    if (len < 0 || len >= sizeof(payload)) {
+        ESP_LOGE(TAG, "Failed to build PPG quality payload");
+        return ESP_FAIL;
+    }
+
+    // Publish message
+    int msg_id = esp_mqtt_client_publish(mqtt_client, TELEMETRY_TOPIC,
+                                         payload, 0, 1, 0);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish PPG quality");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "PPG quality published: %s", payload);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_publish_ppg_stats(uint32_t samples, uint32_t fifo_overflows, uint32_t frames_dropped) {
+    // Check connection status
+    if (!mqtt_client || !mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, skipping publish");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Build JSON payload
+    char payload[128];
+    int len = snprintf(payload, sizeof(payload),
+        "{\"ppgSamples\":%lu,\"ppgFifoOverflows\":%lu,\"ppgFramesDropped\":%lu}",
+        (unsigned long)samples, (unsigned long)fifo_overflows, (unsigned long)frames_dropped);
+
+    if (len < 0 || len >= sizeof(payload)) {
+        ESP_LOGE(TAG, "Failed to build PPG stats payload");
+        return ESP_FAIL;
+    }
+
+    // Publish message
+    int msg_id = esp_mqtt_client_publish(mqtt_client, TELEMETRY_TOPIC,
+                                         payload, 0, 1, 0);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish PPG stats");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "PPG stats published: %s", payload);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_publish_fall_event(const char *payload, size_t len) {
+    if (!payload || len == 0) {
+        ESP_LOGE(TAG, "Invalid fall event");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Check connection status
+    if (!mqtt_client || !mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, skipping publish");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Publish message (larger than the TX buffer, esp-mqtt sends it in parts)
+    int msg_id = esp_mqtt_client_publish(mqtt_client, TELEMETRY_TOPIC,
+                                         payload, len, 1, 0);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish fall event");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Fall event published: %u bytes", (unsigned)len);
+    return ESP_OK;
+}
+
 /**
  * @brief Publish device attributes to ThingsBoard
  * @param patient_id Patient ID
@@ -362,6 +590,60 @@ esp_err_t mqtt_publish_attributes(const char *patient_id, const char *doctor_id)
     return ESP_OK;
 }
 
+esp_err_t mqtt_publish_spo2_calib(const char *lot, int points) {
+    if (!lot) {
+        ESP_LOGE(TAG, "Invalid calibration lot");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!mqtt_client || !mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, skipping publish");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Build attributes JSON payload
+    char payload[96];
+    int len = snprintf(payload, sizeof(payload),
+        "{\"spo2CalibLot\":\"%s\",\"spo2CalibPoints\":%d}", lot, points);
+
+    if (len < 0 || len >= sizeof(payload)) {
+        ESP_LOGE(TAG, "Failed to build calibration payload");
+        return ESP_FAIL;
+    }
+
+    // Publish message
+    int msg_id = esp_mqtt_client_publish(mqtt_client, ATTRIBUTES_TOPIC,
+                                         payload, 0, 1, 0);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish calibration");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Calibration published: %s", payload);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_register_attribute(const char *key, mqtt_attr_cb_t cb) {
+    if (!key || !cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < s_attr_handler_count; i++) {
+        if (strcmp(s_attr_handlers[i].key, key) == 0) {
+            s_attr_handlers[i].cb = cb;
+            return ESP_OK;
+        }
+    }
+    if (s_attr_handler_count >= MQTT_ATTR_CB_MAX) {
+        ESP_LOGE(TAG, "No room for attribute handler %s", key);
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_attr_handlers[s_attr_handler_count].key = key;
+    s_attr_handlers[s_attr_handler_count].cb = cb;
+    s_attr_handler_count++;
+    return ESP_OK;
+}
+
 /**
  * @brief Stop MQTT client
  * @return ESP_OK on success, error code otherwise
@@ -400,6 +682,6 @@ uint8_t mqtt_is_connected(void) {
  * @brief Start OTA scheduler task
  */
 void mqtt_start_ota_scheduler(void) {
-    xTaskCreate(ota_scheduler_task, "ota_sched", 4096, NULL, 5, NULL);
+    task_map_create(TASK_OTA_SCHED, ota_scheduler_task, NULL, NULL);
     ESP_LOGI(TAG, "OTA scheduler started");
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define MQTT_TB_H
 
 #include "esp_err.h"
+#include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "sytem_config.h"
@@ -19,9 +20,56 @@ esp_err_t mqtt_client_init(const char *token);
  * @param spo2 Blood oxygen saturation (%)
  * @param temperature Body temperature (°C)
  * @param alarm_status Alarm status string
+ * @param include_ppg false leaves heartRate and SpO2 out (invalid or
+ *                    low-confidence reading) instead of sending noise
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t mqtt_publish_telemetry(int heart_rate, double spo2, float temperature, const char *alarm_status); 
+esp_err_t mqtt_publish_telemetry(int heart_rate, double spo2, float temperature, const char *alarm_status,
+                                 bool include_ppg);
+
+/**
+ * @brief Publish heart rate variability telemetry to ThingsBoard
+ * @param sdnn_ms SDNN over the HRV horizon (ms)
+ * @param rmssd_ms RMSSD over the HRV horizon (ms)
+ * @param pnn50 Successive differences above 50 ms (%)
+ * @param rr_ms Most recent inter-beat interval (ms)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_hrv(float sdnn_ms, float rmssd_ms, float pnn50, int rr_ms);
+
+/**
+ * @brief Publish the respiratory rate to ThingsBoard
+ * @param breaths_per_min Rate fused from the PPG respiratory modulations
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_resp_rate(float breaths_per_min);
+
+/**
+ * @brief Publish the signal quality behind the current PPG reading
+ * @param perfusion_index IR AC/DC (%)
+ * @param confidence 0-100 score of the reading
+ * @param beats Accepted beat intervals in the window
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_ppg_quality(float perfusion_index, int confidence, int beats);
+
+/**
+ * @brief Publish PPG acquisition counters to ThingsBoard
+ * @param samples FIFO samples read since boot
+ * @param fifo_overflows Samples lost to MAX30102 FIFO overflow
+ * @param frames_dropped Windows skipped while the compute task was busy
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_ppg_stats(uint32_t samples, uint32_t fifo_overflows, uint32_t frames_dropped);
+
+/**
+ * @brief Publish a fall event record (raw IMU capture) to ThingsBoard
+ * @param payload Telemetry JSON built by the caller, several kB, so it
+ *                lives in the caller's static buffer rather than here
+ * @param len Payload length
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_fall_event(const char *payload, size_t len);
 
 /**
  * @brief Publish device attributes to ThingsBoard
@@ -31,6 +79,31 @@ esp_err_t mqtt_publish_telemetry(int heart_rate, double spo2, float temperature,
  */
 esp_err_t mqtt_publish_attributes(const char *patient_id, const char *doctor_id);
 
+/**
+ * @brief Publish the active SpO2 calibration as client attributes
+ * @param lot Sensor lot of the table ("default" for the built-in one)
+ * @param points Number of points in the table
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publish_spo2_calib(const char *lot, int points);
+
+/**
+ * @brief Handler of one shared attribute
+ * @param value The attribute value (object, array, string or number)
+ * @details Runs in the MQTT task, for pushed updates and for the responses
+ *          to the periodic attribute request alike.
+ */
+typedef void (*mqtt_attr_cb_t)(const cJSON *value);
+
+/**
+ * @brief Register the handler of a shared attribute
+ * @param key Attribute key, also added to the periodic request
+ * @param cb Handler
+ * @return ESP_OK, or ESP_ERR_NO_MEM when MQTT_ATTR_CB_MAX keys are taken
+ * @note Call before mqtt_client_init()
+ */
+esp_err_t mqtt_register_attribute(const char *key, mqtt_attr_cb_t cb);
+
 /**
  * @brief Stop MQTT client
  * @return ESP_OK on success, error code otherwise
@@ -2,6 +2,7 @@
 #include "onewire_bus.h"
 #include "ds18b20.h"
 #include "esp_log.h"
+#include "task_map.h"
 #include "freertos/task.h"
 
 static const char *TAG = "TEMPERATURE";
@@ -111,16 +112,7 @@ esp_err_t temperature_start_task(void (*callback)(float temp)) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    BaseType_t ret = xTaskCreate(
-        temperature_task,
-        "temp_task",
-        4096,
-        (void*)callback,
-        5,
-        NULL
-    );
-
-    if (ret != pdPASS) {
+    if (task_map_create(TASK_TEMP, temperature_task, (void*)callback, NULL) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create temperature task");
         return ESP_FAIL;
     }
@@ -1,20 +1,61 @@
 #include "algorithm.h"
+#include "ppg_calib.h"
+#include "ppg_kernels.h"
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
 
-double time_array[BUFFER_SIZE];
+algorithm_context_t algo_ctx;
+
+#if (BUFFER_SIZE & (BUFFER_SIZE - 1)) != 0
+#error "BUFFER_SIZE must be a power of two for the radix-2 FFT"
+#endif
 
 #define DEBUG true
 #define MINIMUM_RATIO 0.3
 
-//Apenas inicia o array do tempo.
-void init_time_array()
+static void init_spectral_tables(void);
+
+void algorithm_init(uint32_t adc_rate_sps, uint32_t averaging, int window_len)
 {
-	double time = 0;
-	for(int i = 0; i < BUFFER_SIZE; i++){
-		time_array[i] = time;
-		time += DELAY_AMOSTRAGEM / 1000.0;
+	if(averaging == 0) averaging = 1;
+	algo_ctx.sample_rate = (double)adc_rate_sps / averaging;
+	algo_ctx.sample_period = 1.0 / algo_ctx.sample_rate;
+
+	if(window_len <= 0){
+		window_len = 32;
+		while(window_len < BUFFER_SIZE && window_len < WINDOW_SECONDS * algo_ctx.sample_rate){
+			window_len <<= 1;
+		}
+	}
+	if(window_len > BUFFER_SIZE) window_len = BUFFER_SIZE;
+	while(window_len & (window_len - 1)){
+		window_len &= window_len - 1; //Arredonda para baixo até potência de 2 (FFT).
 	}
+	if(window_len < 32) window_len = 32;
+	algo_ctx.window_len = window_len;
+
+	//Eixo do tempo: somas fechadas, sem recalcular a cada janela.
+	int64_t n = window_len;
+	algo_ctx.sum_i = n * (n - 1) / 2;
+	algo_ctx.sum_i2 = (n - 1) * n * (2 * n - 1) / 6;
+	algo_ctx.sum_x = algo_ctx.sum_i * algo_ctx.sample_period;
+	algo_ctx.sum_x2 = algo_ctx.sum_i2 * algo_ctx.sample_period * algo_ctx.sample_period;
+
+	algo_ctx.bpm_lag_factor = 60.0 * algo_ctx.sample_rate;
+	algo_ctx.bpm_lag_factor_q8 = (int32_t)(algo_ctx.bpm_lag_factor * 256.0 + 0.5);
+	algo_ctx.lag_min = (int)(algo_ctx.bpm_lag_factor / HR_MAX_BPM);
+	algo_ctx.lag_max = (int)ceil(algo_ctx.bpm_lag_factor / HR_MIN_BPM);
+	if(algo_ctx.lag_min < 2) algo_ctx.lag_min = 2;
+	if(algo_ctx.lag_max > window_len - 2) algo_ctx.lag_max = window_len - 2;
+
+	algo_ctx.bin_hz = (float)(algo_ctx.sample_rate / window_len);
+	algo_ctx.bin_min = (int)ceilf((HR_MIN_BPM / 60.0f) / algo_ctx.bin_hz);
+	algo_ctx.bin_max = (int)((HR_MAX_BPM / 60.0f) / algo_ctx.bin_hz);
+	if(algo_ctx.bin_min < 1) algo_ctx.bin_min = 1;
+	if(algo_ctx.bin_max > window_len / 2 - 2) algo_ctx.bin_max = window_len / 2 - 2;
+
+	init_spectral_tables();
 }
 
 
@@ -22,15 +63,15 @@ void remove_dc_part(int32_t *ir_buffer, int32_t *red_buffer, uint64_t *ir_mean,
 {
 	*ir_mean = 0;
 	*red_mean = 0;
-	for(int i = 0; i < BUFFER_SIZE; i++){
+	for(int i = 0; i < algo_ctx.window_len; i++){
 		*ir_mean += ir_buffer[i];
 	    *red_mean += red_buffer[i];
 	}
 
-	*ir_mean = *ir_mean / (BUFFER_SIZE);
-	*red_mean = *red_mean / (BUFFER_SIZE);
+	*ir_mean = *ir_mean / algo_ctx.window_len;
+	*red_mean = *red_mean / algo_ctx.window_len;
 
-	for(int i = 0; i < BUFFER_SIZE; i++){
+	for(int i = 0; i < algo_ctx.window_len; i++){
 		red_buffer[i] = red_buffer[i] - *red_mean;
 		ir_buffer[i] = ir_buffer[i] - *ir_mean;
 	}
@@ -38,6 +79,14 @@ void remove_dc_part(int32_t *ir_buffer, int32_t *red_buffer, uint64_t *ir_mean,
 }
 
 
+#if !PPG_FIXED_POINT
+//Double implementation; the fixed-point build lives in algorithm_fixed.c.
+
+//Janelas convertidas para float para os kernels vetoriais (ppg_kernels.c).
+//Janela + zeros até lag_max + 1 na correlação, ou duas janelas lado a lado.
+static float kernel_vec[2 * BUFFER_SIZE] PPG_KERNEL_ALIGN;
+static float kernel_acf[BUFFER_SIZE] PPG_KERNEL_ALIGN;
+
 void remove_trend_line(int32_t *buffer)
 {
 	double a = 0;
@@ -50,9 +99,9 @@ void remove_trend_line(int32_t *buffer)
 	printf("linear coef = %f\n", b);
 */
 	double time = 0;
-	for(int i = 0; i < BUFFER_SIZE; i++){
+	for(int i = 0; i < algo_ctx.window_len; i++){
 		buffer [i] = ((buffer[i] + (-a * time)) - b);
-		time += DELAY_AMOSTRAGEM / 1000.0;
+		time += algo_ctx.sample_period;
 	}
 }
 
@@ -61,16 +110,16 @@ void remove_trend_line(int32_t *buffer)
 void calculate_linear_regression(double *angular_coef, double *linear_coef, int32_t *data)
 {
 	int64_t sum_of_y = sum_of_elements(data);
-	double sum_of_x = 325.12; //Automatizar...
-	double sum_of_x2 = somatoria_x2();
+	double sum_of_x = algo_ctx.sum_x;
+	double sum_of_x2 = algo_ctx.sum_x2;
 	double sum_of_xy = sum_of_xy_elements(data);
 	double sum_of_x_squared = (sum_of_x * sum_of_x);
 
-	double temp = (sum_of_xy - (sum_of_x * sum_of_y) / BUFFER_SIZE);
-	double temp2 = (sum_of_x2 - (sum_of_x_squared / BUFFER_SIZE));
+	double temp = (sum_of_xy - (sum_of_x * sum_of_y) / algo_ctx.window_len);
+	double temp2 = (sum_of_x2 - (sum_of_x_squared / algo_ctx.window_len));
 
 	*angular_coef = temp/temp2;
-	*linear_coef = ((sum_of_y/BUFFER_SIZE) - (*angular_coef*(sum_of_x/BUFFER_SIZE)));
+	*linear_coef = ((sum_of_y/algo_ctx.window_len) - (*angular_coef*(sum_of_x/algo_ctx.window_len)));
 }
 
 
@@ -80,33 +129,30 @@ void calculate_linear_regression(double *angular_coef, double *linear_coef, int3
  */
 double correlation_datay_datax(int32_t *data_red, int32_t *data_ir)
 {
-
 	double correlation = 0;
 	double x_mean = 0;
 	double y_mean = 0;
-	double volatile sum_of_x = 0;
-	double volatile sum_of_y = 0;
 	double sum_of_x_minus_xmean2 = 0;
 	double sum_of_y_minus_ymean2 = 0;
 	double covar_xy = 0;  //Covariância de XY
 	double sx = 0;  //desvio padrão X
 	double sy = 0;  //Desvião padrão de Y
+	float *x = kernel_vec;
+	float *y = kernel_vec + BUFFER_SIZE;
 
-	for(int i = 0; i < BUFFER_SIZE; i++){
-		sum_of_x += data_red[i];
-		sum_of_y += data_ir[i];
-	}
-	x_mean = sum_of_x / BUFFER_SIZE;
-	y_mean = sum_of_y / BUFFER_SIZE;
+	x_mean = (double)sum_of_elements(data_red) / algo_ctx.window_len;
+	y_mean = (double)sum_of_elements(data_ir) / algo_ctx.window_len;
 
-	for(int i = 0; i < BUFFER_SIZE; i++){
-		sum_of_x_minus_xmean2 += ((data_red[i] - x_mean)*(data_red[i] - x_mean));
-		sum_of_y_minus_ymean2 += ((data_ir[i] - y_mean)*(data_ir[i] - y_mean));
-		covar_xy += ((data_red[i] - x_mean)*(data_ir[i] - y_mean));
-	}
-	sx = sqrt(sum_of_x_minus_xmean2 / (BUFFER_SIZE)); //desvio padrão de x
-	sy = sqrt(sum_of_y_minus_ymean2 / (BUFFER_SIZE)); //devio padrão de y
-	covar_xy = (covar_xy / (BUFFER_SIZE));
+	//Centrado antes da conversão para float: os produtos ficam na escala do AC.
+	ppg_kernel_to_float(data_red, x, algo_ctx.window_len, (float)x_mean);
+	ppg_kernel_to_float(data_ir, y, algo_ctx.window_len, (float)y_mean);
+	sum_of_x_minus_xmean2 = ppg_kernel_dot(x, x, algo_ctx.window_len);
+	sum_of_y_minus_ymean2 = ppg_kernel_dot(y, y, algo_ctx.window_len);
+	covar_xy = ppg_kernel_dot(x, y, algo_ctx.window_len);
+
+	sx = sqrt(sum_of_x_minus_xmean2 / (algo_ctx.window_len)); //desvio padrão de x
+	sy = sqrt(sum_of_y_minus_ymean2 / (algo_ctx.window_len)); //devio padrão de y
+	covar_xy = (covar_xy / (algo_ctx.window_len));
 
 
 	correlation = (covar_xy / (sx * sy));
@@ -127,11 +173,8 @@ double spo2_measurement(int32_t *ir_data, int32_t *red_data, uint64_t ir_mean, u
 	// printf("ir_rms %f\n", ir_rms);
 	// printf("Z %f\n", Z);
 
-	//SpO2 = (49.7*Z);
-	//SpO2 = (-45.06*Z + 30.354)*Z + 94.845;
-	SpO2 = 104.0 - (17.0 * Z);
-	if (SpO2 > 100.0) SpO2 = 100.0;
-	if (SpO2 < 70.0) SpO2 = 70.0;
+	//Curva do lote do sensor (ppg_calib), por padrão a reta 104 - 17*Z.
+	SpO2 = ppg_calib_spo2(Z);
 	return SpO2;
 }
 
@@ -140,20 +183,36 @@ int calculate_heart_rate(int32_t *ir_data, double *r0, double *auto_correlationa
 {
 	double auto_correlation_result;
 	double resultado = 333;
-	double auto_coorelation_0 = auto_correlation_function(ir_data, 0);
-	*r0 = auto_coorelation_0;
-	// printf("R0 %f\n", *r0);
 	double biggest_value = 0;
 	int biggest_value_index = 0;
 	double division;
+	double previous = 1.0;
+	bool rising = false;
+
+	//Todos os lags de uma vez: correlação da janela com ela mesma seguida
+	//de zeros, então o lag k soma só as N - k amostras sobrepostas.
+	int n = algo_ctx.window_len;
+	int first_lag = algo_ctx.lag_min - 2;
+	int lags = algo_ctx.lag_max + 1 - first_lag + 1;
+	float *x = kernel_vec;
+	ppg_kernel_to_float(ir_data, x, n, 0);
+	memset(&x[n], 0, (algo_ctx.lag_max + 2) * sizeof(float));
+	ppg_kernel_corr(&x[first_lag], n + lags - 1, x, n, kernel_acf);
+
+	double auto_coorelation_0 = ppg_kernel_dot(x, x, n) / n;
+	*r0 = auto_coorelation_0;
+	// printf("R0 %f\n", *r0);
 
-
-	for(float i = 0; i < 125; i++){
-		auto_correlation_result = auto_correlation_function(ir_data, i);
+	//Só os lags da banda HR_MIN_BPM..HR_MAX_BPM; o pico só vale depois que a
+	//autocorrelação voltou a subir (fora do lóbulo central).
+	for(int i = algo_ctx.lag_min - 2; i <= algo_ctx.lag_max + 1; i++){
+		auto_correlation_result = (double)kernel_acf[i - first_lag] / n;
 		division = auto_correlation_result/auto_coorelation_0;
-		auto_correlationated_data[(int)i] = division;
+		auto_correlationated_data[i] = division;
+		if(division > previous) rising = true;
+		previous = division;
 
-		if(i > 10){
+		if(rising && i >= algo_ctx.lag_min){
 			if(division > MINIMUM_RATIO){
 				if(biggest_value < division){
 					biggest_value = division;
@@ -161,7 +220,7 @@ int calculate_heart_rate(int32_t *ir_data, double *r0, double *auto_correlationa
 					continue;
 				}
 
-				resultado = ((1 / (biggest_value_index * (DELAY_AMOSTRAGEM / 1000.0))) * 60);
+				resultado = algo_ctx.bpm_lag_factor / biggest_value_index;
 #if !DEBUG
 				return((int)resultado); //Não retorna daqui seestiver debugando.
 #endif
@@ -174,12 +233,13 @@ int calculate_heart_rate(int32_t *ir_data, double *r0, double *auto_correlationa
 
 double auto_correlation_function(int32_t *data, int32_t lag)
 {
-	double soma = 0;
+	int64_t soma = 0;
 	double resultado = 0;
-	for(int i = 0; i < (BUFFER_SIZE - lag); i++){
-		soma += ((data[i]) * (data[i + lag]));
+	//Produto em 64 bits: com AC grande (movimento) o produto int32 estoura.
+	for(int i = 0; i < (algo_ctx.window_len - lag); i++){
+		soma += (int64_t)data[i] * data[i + lag];
 	}
-	resultado = soma / BUFFER_SIZE;
+	resultado = (double)soma / algo_ctx.window_len;
 	return resultado;
 }
 
@@ -187,7 +247,7 @@ double auto_correlation_function(int32_t *data, int32_t lag)
 int64_t sum_of_elements(int32_t *data)
 {
 	int64_t sum = 0;
-	for(int i = 0; i < BUFFER_SIZE; i++){
+	for(int i = 0; i < algo_ctx.window_len; i++){
 		sum += data[i];
 	}
 	return sum;
@@ -198,9 +258,9 @@ double sum_of_xy_elements(int32_t *data)
 {
 	double sum_xy = 0;
 	double time = 0;
-	for(int i = 0; i < BUFFER_SIZE; i++){
+	for(int i = 0; i < algo_ctx.window_len; i++){
 		sum_xy += (data[i] * time);
-		time += DELAY_AMOSTRAGEM / 1000.0;
+		time += algo_ctx.sample_period;
 	}
 	return sum_xy;
 }
@@ -210,9 +270,9 @@ double sum_of_squared_elements(int32_t *data)
 {
 	double sum_squared = 0;
 	int time = 0;
-	for(int i = 0; i < BUFFER_SIZE; i++){
+	for(int i = 0; i < algo_ctx.window_len; i++){
 		sum_squared += (data[i] * data[i]);
-		time += DELAY_AMOSTRAGEM / 1000.0;
+		time += algo_ctx.sample_period;
 	}
 	return sum_squared;
 }
@@ -220,28 +280,121 @@ double sum_of_squared_elements(int32_t *data)
 
 double somatoria_x2()
 {
-	float incremento = (DELAY_AMOSTRAGEM / 1000.0);
-	double resultado = 0.0;
-	double squared_values = 0;
-	float temp = 0;
+	return algo_ctx.sum_x2; //Pré-calculado em algorithm_init().
+}
 
 
-	for(int i = 0; i < BUFFER_SIZE; i++){
-		squared_values = temp * temp;
-		temp += incremento;
-		resultado += squared_values;
+double rms_value(int32_t *data)
+{
+	double result = 0;
+	float *x = kernel_vec;
+	ppg_kernel_to_float(data, x, algo_ctx.window_len, 0);
+	result = sqrt(ppg_kernel_dot(x, x, algo_ctx.window_len) / algo_ctx.window_len);
+	return result;
+}
+#endif /* !PPG_FIXED_POINT */
+
+
+/*
+ * Spectral heart rate estimator.
+ * One radix-2 FFT of the Hann-windowed window replaces the 125 O(N)
+ * autocorrelation lags. Everything is single precision, which the ESP32
+ * FPU executes in hardware. The dominant bin in the HR_MIN_BPM..HR_MAX_BPM
+ * band is refined with a parabola through its neighbours, since one bin
+ * is 60 * fs / N BPM wide (~11.7 BPM at 50 Hz and N = 256).
+ */
+static float fft_re[BUFFER_SIZE];
+static float fft_im[BUFFER_SIZE];
+static float twiddle_cos[BUFFER_SIZE / 2];
+static float twiddle_sin[BUFFER_SIZE / 2];
+static float hann_window[BUFFER_SIZE];
+
+
+static void init_spectral_tables(void)
+{
+	const int n = algo_ctx.window_len;
+
+	for(int i = 0; i < n / 2; i++){
+		twiddle_cos[i] = cosf(2.0f * (float)M_PI * i / n);
+		twiddle_sin[i] = -sinf(2.0f * (float)M_PI * i / n);
+	}
+	for(int i = 0; i < n; i++){
+		hann_window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (n - 1));
 	}
-	return resultado;
 }
 
 
-double rms_value(int32_t *data)
+//FFT complexa in-place, decimação no tempo.
+static void fft_radix2(float *re, float *im)
 {
-	double result = 0;
-	int32_t somatoria = 0;
-	for(int i = 0; i <BUFFER_SIZE; i++){
-		somatoria += (data[i] * data[i]);
+	const int n = algo_ctx.window_len;
+
+	for(int i = 1, j = 0; i < n; i++){
+		int bit = n >> 1;
+		for(; j & bit; bit >>= 1){
+			j ^= bit;
+		}
+		j ^= bit;
+		if(i < j){
+			float t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
 	}
-	result = sqrt(somatoria / BUFFER_SIZE);
-	return result;
+
+	for(int len = 2; len <= n; len <<= 1){
+		int half = len >> 1;
+		int step = n / len;
+		for(int i = 0; i < n; i += len){
+			for(int k = 0; k < half; k++){
+				float wr = twiddle_cos[k * step];
+				float wi = twiddle_sin[k * step];
+				int a = i + k;
+				int b = a + half;
+				float tr = re[b] * wr - im[b] * wi;
+				float ti = re[b] * wi + im[b] * wr;
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+
+int calculate_heart_rate_spectral(int32_t *ir_data)
+{
+	const float bin_hz = algo_ctx.bin_hz;
+	const int k_min = algo_ctx.bin_min;
+	const int k_max = algo_ctx.bin_max;
+
+	for(int i = 0; i < algo_ctx.window_len; i++){
+		fft_re[i] = ir_data[i] * hann_window[i];
+		fft_im[i] = 0;
+	}
+	fft_radix2(fft_re, fft_im);
+
+	int peak = 0;
+	float peak_mag2 = 0;
+	for(int k = k_min; k <= k_max; k++){
+		float mag2 = fft_re[k] * fft_re[k] + fft_im[k] * fft_im[k];
+		if(mag2 > peak_mag2){
+			peak_mag2 = mag2;
+			peak = k;
+		}
+	}
+	if(peak == 0){
+		return 333; //Mesmo sentinela de calculate_heart_rate(): sem pico.
+	}
+
+	//Interpolação parabólica sobre as magnitudes de k-1, k, k+1.
+	float a = sqrtf(fft_re[peak - 1] * fft_re[peak - 1] + fft_im[peak - 1] * fft_im[peak - 1]);
+	float b = sqrtf(peak_mag2);
+	float c = sqrtf(fft_re[peak + 1] * fft_re[peak + 1] + fft_im[peak + 1] * fft_im[peak + 1]);
+	float denom = a - 2.0f * b + c;
+	float delta = (denom != 0) ? 0.5f * (a - c) / denom : 0;
+	if (delta > 0.5f) delta = 0.5f;
+	if (delta < -0.5f) delta = -0.5f;
+
+	return (int)lroundf((peak + delta) * bin_hz * 60.0f);
 }
@@ -7,6 +7,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/*
+ * PPG_FIXED_POINT = 1 builds algorithm_fixed.c instead of the double routines
+ * (idf.py -DPPG_FIXED_POINT=1 build). Same API; accumulators are int32/int64
+ * and only the final result is converted to double. Worst-case error against
+ * the double build for 18-bit samples:
+ *   remove_dc_part, sum_of_elements, auto_correlation_function: identical
+ *   remove_trend_line: +-2 LSB (Q16 line, rounded; the double build truncates)
+ *   calculate_linear_regression: |da| < 0.01 LSB/s, |db| < 1 LSB
+ *   rms_value: < 2^-8 LSB (integer square root in Q8)
+ *   correlation_datay_datax: |dr| < 5e-4 (integer roots of N^2 * variance)
+ *   spo2_measurement: < 0.01 % SpO2 (Z in Q16)
+ *   calculate_heart_rate: same BPM unless a ratio R(k)/R(0) lies within 2^-15
+ *     of MINIMUM_RATIO or of the running maximum (ratios are Q15)
+ */
+#ifndef PPG_FIXED_POINT
+#define PPG_FIXED_POINT 0
+#endif
+
 void remove_dc_part(int32_t *ir_buffer, int32_t *red_buffer, uint64_t *ir_mean, uint64_t *red_mean);
 void calculate_linear_regression(double *angular_coef, double *linear_coef, int32_t *data);
 double correlation_datay_datax(int32_t *data_red, int32_t *data_ir);
@@ -18,15 +36,60 @@ void remove_trend_line(int32_t *buffer);
 double sum_of_xy_elements(int32_t *data);
 int64_t sum_of_elements(int32_t *data);
 double sum_of_squared_elements(int32_t *data);
-double somatoria_x2() __attribute__ ((optimize(2))); //Otimiza a função para que a mesma não seja chamada toda hora. Não soube fazer tudo com macros...
-void init_time_array();
+double somatoria_x2();
 int calculate_heart_rate(int32_t *ir_data, double *r0, double *auto_correlationated_data);
 double spo2_measurement(int32_t *ir_data, int32_t *red_data, uint64_t ir_mean, uint64_t red_mean);
 double rms_value(int32_t *data);
 double auto_correlation_function(int32_t *data, int32_t lag);
 
-#define BUFFER_SIZE 128
-#define DELAY_AMOSTRAGEM 40
+//Estimador espectral: FFT radix-2 da janela + pico com interpolação parabólica.
+typedef enum {
+	HR_ESTIMATOR_AUTOCORRELATION = 0,	// calculate_heart_rate()
+	HR_ESTIMATOR_SPECTRAL,				// calculate_heart_rate_spectral()
+	HR_ESTIMATOR_BEATS					// Intervalo médio do detector de batimentos (ppg_beat)
+} hr_estimator_t;
+
+int calculate_heart_rate_spectral(int32_t *ir_data);
+
+#define BUFFER_SIZE 512		//Capacidade máxima da janela (potência de 2)
+#define WINDOW_SECONDS 4	//Duração mínima da janela automática
+#define HR_MIN_BPM 40		//Banda de busca dos estimadores
+#define HR_MAX_BPM 200
+
+/*
+ * Everything that depends on the sample rate and window length, computed
+ * once by algorithm_init() from the sensor configuration instead of being
+ * hardcoded for a single rate. All routines above work on the first
+ * window_len samples of their buffers.
+ */
+typedef struct {
+	double sample_rate;		// Effective rate after on-chip averaging (Hz)
+	double sample_period;	// 1 / sample_rate (s)
+	int window_len;			// N, power of two <= BUFFER_SIZE
+	double sum_x;			// Σ t_i over the window (s)
+	double sum_x2;			// Σ t_i^2 (s^2)
+	int64_t sum_i;			// Σ i over the window (samples)
+	int64_t sum_i2;			// Σ i^2
+	int lag_min;			// Autocorrelation lag of HR_MAX_BPM
+	int lag_max;			// Autocorrelation lag of HR_MIN_BPM
+	double bpm_lag_factor;	// BPM = bpm_lag_factor / lag
+	int32_t bpm_lag_factor_q8;
+	float bin_hz;			// Spectral resolution fs / N
+	int bin_min;			// FFT bins covering HR_MIN_BPM..HR_MAX_BPM
+	int bin_max;
+} algorithm_context_t;
+
+extern algorithm_context_t algo_ctx;
+
+/**
+ * @brief Build algo_ctx from the sensor configuration
+ * @param adc_rate_sps  MAX30102 SPO2_SR rate (samples per second)
+ * @param averaging     FIFO SMP_AVE factor (1..32)
+ * @param window_len    Window length; 0 picks the smallest power of two
+ *                      covering WINDOW_SECONDS
+ * @note Must be called before any other routine (replaces init_time_array())
+ */
+void algorithm_init(uint32_t adc_rate_sps, uint32_t averaging, int window_len);
 
 
 #endif
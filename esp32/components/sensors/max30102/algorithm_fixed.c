@@ -0,0 +1,240 @@
+#include "algorithm.h"
+#include "ppg_calib.h"
+#include <stdbool.h>
+
+#if PPG_FIXED_POINT
+/*
+ * Fixed-point versions of the algorithm.c routines. The time axis is the
+ * sample index (t = i * algo_ctx.sample_period), so the sums of x and x^2
+ * are the integer constants algo_ctx.sum_i and sum_i2, and every sum of y
+ * fits in int64 for 18-bit samples and windows up to 1024 samples. The ESP32 has no double-precision FPU, so each
+ * double operation of the original is replaced by integer arithmetic.
+ */
+
+#define DEBUG true
+#define MINIMUM_RATIO_Q15 9830 //0.3 in Q15
+
+#define N_WIN   algo_ctx.window_len
+#define SUM_X   algo_ctx.sum_i
+#define SUM_X2  algo_ctx.sum_i2
+
+
+//Integer square root (floor), bit by bit.
+static uint32_t isqrt64(uint64_t value)
+{
+	uint64_t result = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while(bit > value){
+		bit >>= 2;
+	}
+	while(bit != 0){
+		if(value >= result + bit){
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)result;
+}
+
+
+static int64_t sum_of_index_weighted(int32_t *data)
+{
+	int64_t sum = 0;
+	for(int i = 0; i < N_WIN; i++){
+		sum += (int64_t)i * data[i];
+	}
+	return sum;
+}
+
+
+//Line y = a*i + b with a and b in Q16, i in samples.
+static void linear_regression_q16(int32_t *data, int64_t *a_q16, int64_t *b_q16)
+{
+	int64_t sum_y = sum_of_elements(data);
+	int64_t sum_iy = sum_of_index_weighted(data);
+	int64_t num = (N_WIN * sum_iy) - (SUM_X * sum_y);
+	int64_t den = (N_WIN * SUM_X2) - (SUM_X * SUM_X);
+
+	*a_q16 = (num * 65536) / den;
+	*b_q16 = ((sum_y * 65536) - (*a_q16 * SUM_X)) / N_WIN;
+}
+
+
+void remove_trend_line(int32_t *buffer)
+{
+	int64_t a_q16, line_q16;
+
+	linear_regression_q16(buffer, &a_q16, &line_q16);
+
+	for(int i = 0; i < N_WIN; i++){
+		buffer[i] -= (int32_t)((line_q16 + 32768) >> 16);
+		line_q16 += a_q16;
+	}
+}
+
+
+void calculate_linear_regression(double *angular_coef, double *linear_coef, int32_t *data)
+{
+	int64_t a_q16, b_q16;
+
+	linear_regression_q16(data, &a_q16, &b_q16);
+
+	//Convert once to the API unit (y per second).
+	*angular_coef = (a_q16 * algo_ctx.sample_rate) / 65536.0;
+	*linear_coef = b_q16 / 65536.0;
+}
+
+
+double correlation_datay_datax(int32_t *data_red, int32_t *data_ir)
+{
+	int64_t sum_x = 0, sum_y = 0;
+	int64_t sum_xx = 0, sum_yy = 0, sum_xy = 0;
+
+	for(int i = 0; i < N_WIN; i++){
+		sum_x += data_red[i];
+		sum_y += data_ir[i];
+		sum_xx += (int64_t)data_red[i] * data_red[i];
+		sum_yy += (int64_t)data_ir[i] * data_ir[i];
+		sum_xy += (int64_t)data_red[i] * data_ir[i];
+	}
+
+	//N^2 * variance and N^2 * covariance, exact in int64.
+	int64_t var_x = (N_WIN * sum_xx) - (sum_x * sum_x);
+	int64_t var_y = (N_WIN * sum_yy) - (sum_y * sum_y);
+	int64_t covar_xy = (N_WIN * sum_xy) - (sum_x * sum_y);
+
+	uint32_t sx = isqrt64((uint64_t)var_x);
+	uint32_t sy = isqrt64((uint64_t)var_y);
+	if(sx == 0 || sy == 0){
+		return 0;
+	}
+	return (double)covar_xy / ((double)sx * sy);
+}
+
+
+//RMS in Q8 (root of mean * 2^16); the int64 sum cannot overflow.
+static uint32_t rms_value_q8(int32_t *data)
+{
+	uint64_t sum_squared = 0;
+	for(int i = 0; i < N_WIN; i++){
+		sum_squared += (int64_t)data[i] * data[i];
+	}
+	return isqrt64((sum_squared / N_WIN) << 16);
+}
+
+
+double rms_value(int32_t *data)
+{
+	return rms_value_q8(data) / 256.0;
+}
+
+
+double spo2_measurement(int32_t *ir_data, int32_t *red_data, uint64_t ir_mean, uint64_t red_mean)
+{
+	uint64_t ir_rms_q8 = rms_value_q8(ir_data);
+	uint64_t red_rms_q8 = rms_value_q8(red_data);
+	uint64_t den = ir_rms_q8 * red_mean;
+
+	if(den == 0){
+		return 100.0;
+	}
+
+	//Z = (red_rms/red_mean) / (ir_rms/ir_mean) in Q16.
+	int64_t z_q16 = (int64_t)(((red_rms_q8 * ir_mean) << 16) / den);
+	if (z_q16 > INT32_MAX) z_q16 = INT32_MAX;
+	return ppg_calib_spo2_q16((int32_t)z_q16) / 65536.0;
+}
+
+
+static int64_t auto_correlation_sum(int32_t *data, int32_t lag)
+{
+	int64_t soma = 0;
+	for(int i = 0; i < (N_WIN - lag); i++){
+		soma += (int64_t)data[i] * data[i + lag];
+	}
+	return soma;
+}
+
+
+double auto_correlation_function(int32_t *data, int32_t lag)
+{
+	return (double)auto_correlation_sum(data, lag) / N_WIN;
+}
+
+
+int calculate_heart_rate(int32_t *ir_data, double *r0, double *auto_correlationated_data)
+{
+	int resultado = 333;
+	int64_t auto_coorelation_0 = auto_correlation_sum(ir_data, 0);
+	*r0 = (double)auto_coorelation_0 / N_WIN;
+	int32_t biggest_value = 0;
+	int biggest_value_index = 0;
+	int32_t previous = 32768;
+	bool rising = false;
+
+	if(auto_coorelation_0 <= 0){
+		return resultado;
+	}
+
+	for(int i = algo_ctx.lag_min - 2; i <= algo_ctx.lag_max + 1; i++){
+		int64_t acf = auto_correlation_sum(ir_data, i);
+		int32_t division = (int32_t)((acf * 32768) / auto_coorelation_0);
+		auto_correlationated_data[i] = division / 32768.0;
+		if(division > previous) rising = true;
+		previous = division;
+
+		if(rising && i >= algo_ctx.lag_min){
+			if(division > MINIMUM_RATIO_Q15){
+				if(biggest_value < division){
+					biggest_value = division;
+					biggest_value_index = i;
+					continue;
+				}
+
+				resultado = (algo_ctx.bpm_lag_factor_q8 / biggest_value_index) >> 8;
+#if !DEBUG
+				return resultado; //Não retorna daqui seestiver debugando.
+#endif
+			}
+		}
+	}
+	return resultado;
+}
+
+
+int64_t sum_of_elements(int32_t *data)
+{
+	int64_t sum = 0;
+	for(int i = 0; i < N_WIN; i++){
+		sum += data[i];
+	}
+	return sum;
+}
+
+
+double sum_of_xy_elements(int32_t *data)
+{
+	return sum_of_index_weighted(data) * algo_ctx.sample_period;
+}
+
+
+double sum_of_squared_elements(int32_t *data)
+{
+	int64_t sum_squared = 0;
+	for(int i = 0; i < N_WIN; i++){
+		sum_squared += (int64_t)data[i] * data[i];
+	}
+	return (double)sum_squared;
+}
+
+
+double somatoria_x2()
+{
+	return SUM_X2 * algo_ctx.sample_period * algo_ctx.sample_period;
+}
+
+#endif /* PPG_FIXED_POINT */
@@ -1,14 +1,132 @@
 #include "heart_rate.h"
 #include "max30102_api.h"
+#include "ppg_window.h"
+#include "ppg_filter.h"
+#include "ppg_beat.h"
+#include "ppg_quality.h"
+#include "ppg_agc.h"
+#include "ppg_motion.h"
+#include "ppg_resp.h"
+#include "task_map.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include <string.h>
 
 static const char *TAG = "HEART_RATE";
 static int latest_heart_rate = 0;
 static double latest_spo2 = 0.0;
 static SemaphoreHandle_t data_mutex = NULL;
+static TaskHandle_t s_acq_task = NULL;   // Acquisition task, woken by the INT ISR
+static bool s_int_mode = false;          // INT pin wired and ISR installed
+static ppg_window_t s_window;            // Sliding window over the sample stream
+static ppg_filter_t s_filter_ir;         // Per-sample DC tracker + band-pass
+static ppg_filter_t s_filter_red;
+static ppg_beat_t s_beats;               // Systolic peaks / RR intervals on filtered IR
+static ppg_resp_t s_resp;                // Respiratory BW/AM/FM series, fed per sample and beat
+static uint32_t s_resp_next;             // s_resp.n of the next estimate
+static ppg_resp_t s_resp_snap;           // Copy of s_resp the compute task estimates from
+static volatile bool s_resp_snap_busy = false;  // s_resp_snap handed over, not yet estimated
+static ppg_resp_result_t s_resp_result;  // Latest respiratory estimate (compute task)
+static ppg_motion_t s_motion;            // Accelerometer-referenced artifact canceller
+static ppg_motion_ref_t s_motion_ref;    // Written by heart_rate_push_motion()
+static portMUX_TYPE s_motion_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_finger_present = false;    // Cleared by the quality gate, set by the probe
+static bool s_probing = false;           // LEDs at MAX30102_PROBE_LED_PA
+static ppg_agc_t s_agc = {               // LED drive / ADC range while measuring
+    .red_pa = MAX30102_LED_PA,
+    .ir_pa = MAX30102_LED_PA,
+    .adc_range = MAX30102_ADC_RANGE,
+};
+static bool s_stream_started = false;    // Window primed since the last (re)start
+static hr_estimator_t s_estimator = HEART_RATE_ESTIMATOR;
+static uint8_t s_spo2_sr = 0b010;        // SPO2_SR code, 200 samples per second
+static uint8_t s_smp_ave = 0b010;        // SMP_AVE code, average 4 samples
+static bool s_rate_selected = false;     // heart_rate_set_sample_rate() called
+static volatile bool s_restart_probe = false;  // Compute task saw no finger
+static heart_rate_stats_t s_stats;       // Written by the acquisition task only
+
+/**
+ * @brief One window handed from the acquisition to the compute task
+ */
+typedef struct {
+    int32_t ir[BUFFER_SIZE];
+    int32_t red[BUFFER_SIZE];
+    uint64_t ir_dc;
+    uint64_t red_dc;
+    ppg_quality_t quality;      // NO_FINGER: no samples, else graded by the compute task
+    int beat_bpm;               // ppg_beat_heart_rate() over the window span
+    int beats;                  // ppg_beat_count() over the same span
+    ppg_hrv_t hrv;
+    bool resp_due;              // s_resp_snap holds a new copy to estimate from
+} ppg_frame_t;
+
+// Ping-pong buffers: a frame index is either free, ready or being computed
+#define PPG_FRAME_COUNT 2
+static ppg_frame_t s_frames[PPG_FRAME_COUNT];
+static QueueHandle_t s_free_q = NULL;
+static QueueHandle_t s_ready_q = NULL;
+static task_jitter_t s_acq_jitter;       // FIFO drain period vs. the A_FULL / poll period
+
+// SPO2_CONF.SPO2_SR and FIFO_CONF.SMP_AVE codes (datasheet tables 6 and 8)
+static const uint16_t k_adc_rates[] = {50, 100, 200, 400, 800, 1000, 1600, 3200};
+static const uint8_t k_averaging[] = {1, 2, 4, 8, 16, 32, 32, 32};
+#define MAX_ADC_RATE_CODE 0b011          // 400 sps is the limit with 411 us pulses
+#define LED_PW_411US 0b11                // 18-bit ADC resolution
+
+// Effective rate of the FIFO stream (Hz)
+#define EFFECTIVE_RATE() (k_adc_rates[s_spo2_sr] / k_averaging[s_smp_ave])
+
+/**
+ * @brief MAX30102 INT pin ISR (FIFO almost full)
+ * @details Only wakes the acquisition task; the FIFO burst read that
+ *          follows clears the A_FULL flag and releases the INT line.
+ */
+static void IRAM_ATTR max30102_isr_handler(void *arg) {
+    BaseType_t higher_prio_woken = pdFALSE;
+
+    if (s_acq_task) {
+        vTaskNotifyGiveFromISR(s_acq_task, &higher_prio_woken);
+    }
+    portYIELD_FROM_ISR(higher_prio_woken);
+}
+
+/**
+ * @brief Configure the MAX30102 INT pin as a falling-edge interrupt
+ * @return ESP_OK on success
+ */
+static esp_err_t max30102_int_init(void) {
+    if (MAX30102_INT_PIN == GPIO_NUM_NC) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    gpio_config_t int_conf = {
+        .intr_type = GPIO_INTR_NEGEDGE,          // INT is active-low, open-drain
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << MAX30102_INT_PIN),
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+    };
+
+    esp_err_t err = gpio_config(&int_conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // The ISR service may already be installed by another component
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+
+    return gpio_isr_handler_add(MAX30102_INT_PIN, max30102_isr_handler, NULL);
+}
 
 esp_err_t heart_rate_sensor_init(void) {
     ESP_LOGI(TAG, "Initializing MAX30102...");
@@ -31,13 +149,24 @@ esp_err_t heart_rate_sensor_init(void) {
 
     vTaskDelay(pdMS_TO_TICKS(100));
 
-    // Initialize time array for calculations
-    init_time_array();
+    if (!s_rate_selected && heart_rate_set_sample_rate(HEART_RATE_SAMPLE_RATE_HZ) != ESP_OK) {
+        ESP_LOGW(TAG, "Falling back to %d Hz", EFFECTIVE_RATE());
+    }
+
+    // Time-axis sums, lag range and BPM factor for the configured rate
+    algorithm_init(k_adc_rates[s_spo2_sr], k_averaging[s_smp_ave], 0);
+
+    // Wire the INT pin; fall back to polling the FIFO pointers without it
+    err = max30102_int_init();
+    s_int_mode = (err == ESP_OK);
+    if (!s_int_mode) {
+        ESP_LOGW(TAG, "INT pin unavailable (%s), using FIFO polling", esp_err_to_name(err));
+    }
 
     // Configure MAX30102
     max_config max30102_configuration = {
-        .INT_EN_1.A_FULL_EN         = 0,
-        .INT_EN_1.PPG_RDY_EN        = 1,
+        .INT_EN_1.A_FULL_EN         = s_int_mode ? 1 : 0,
+        .INT_EN_1.PPG_RDY_EN        = 0,
         .INT_EN_1.ALC_OVF_EN        = 0,
         .INT_EN_1.PROX_INT_EN       = 0,
 
@@ -47,20 +176,20 @@ esp_err_t heart_rate_sensor_init(void) {
         .OVEF_COUNTER.OVF_COUNTER   = 0,
         .FIFO_READ_PTR.FIFO_RD_PTR  = 0,
 
-        .FIFO_CONF.SMP_AVE          = 0b001,  // Average 4 samples
+        .FIFO_CONF.SMP_AVE          = s_smp_ave,
         .FIFO_CONF.FIFO_ROLLOVER_EN = 1,
-        .FIFO_CONF.FIFO_A_FULL      = 0,
+        .FIFO_CONF.FIFO_A_FULL      = MAX30102_FIFO_A_FULL,
 
         .MODE_CONF.SHDN             = 0,
         .MODE_CONF.RESET            = 0,
         .MODE_CONF.MODE             = 0b011,  // SpO2 mode
 
-        .SPO2_CONF.SPO2_ADC_RGE     = 0b01,   // 16384 nA
-        .SPO2_CONF.SPO2_SR          = 0b000,  // 200 samples per second
-        .SPO2_CONF.LED_PW           = 0b11,   // 215 μs LED pulse
+        .SPO2_CONF.SPO2_ADC_RGE     = s_agc.adc_range,
+        .SPO2_CONF.SPO2_SR          = s_spo2_sr,
+        .SPO2_CONF.LED_PW           = LED_PW_411US,
 
-        .LED1_PULSE_AMP.LED1_PA     = 0x24,   // 25.4mA
-        .LED2_PULSE_AMP.LED2_PA     = 0x24,   // 25.4mA
+        .LED1_PULSE_AMP.LED1_PA     = s_agc.red_pa,
+        .LED2_PULSE_AMP.LED2_PA     = s_agc.ir_pa,
 
         .PROX_LED_PULS_AMP.PILOT_PA = 0,
 
@@ -76,64 +205,530 @@ esp_err_t heart_rate_sensor_init(void) {
         ESP_LOGE(TAG, "MAX30102 initialization failed: %s", esp_err_to_name(err));
         return err;
     }
+    s_probing = false;
+    s_finger_present = false;
+
+    ESP_LOGI(TAG, "MAX30102 initialized successfully (%d Hz, %d-sample window, %s HR estimator)",
+             EFFECTIVE_RATE(), algo_ctx.window_len,
+             s_estimator == HR_ESTIMATOR_SPECTRAL ? "spectral" :
+             s_estimator == HR_ESTIMATOR_BEATS ? "beat" : "autocorrelation");
+    return ESP_OK;
+}
+
+/**
+ * @brief Finger presence from the raw IR level at the current LED drive
+ */
+static bool finger_present(uint64_t ir_dc) {
+    uint8_t pa = s_probing ? MAX30102_PROBE_LED_PA : s_agc.ir_pa;
+    return ppg_agc_normalize(ir_dc, pa, s_agc.adc_range,
+                             MAX30102_LED_PA, MAX30102_ADC_RANGE) >= PPG_QUALITY_DC_MIN;
+}
+
+/**
+ * @brief Write the auto-gain settings (LED amplitudes and ADC range)
+ */
+static esp_err_t apply_gain(void) {
+    uint8_t spo2_conf = (s_agc.adc_range << 5) | (s_spo2_sr << 2) | LED_PW_411US;
+
+    esp_err_t err = write_max30102_reg(I2C_PORT, spo2_conf, REG_SPO2_CONFIG);
+    if (err == ESP_OK) {
+        err = set_max30102_led_amplitude(I2C_PORT, s_agc.red_pa, s_agc.ir_pa);
+    }
+    if (err == ESP_OK) {
+        s_probing = false;
+        ESP_LOGD(TAG, "Gain: red PA 0x%02x, IR PA 0x%02x, ADC range %u",
+                 s_agc.red_pa, s_agc.ir_pa, s_agc.adc_range);
+    }
+    return err;
+}
+
+/**
+ * @brief Apply an auto-gain step and carry the stream state across it
+ * @param before Gain the samples so far were taken at
+ * @details The DC trackers and band-pass stages would ring on the step and
+ *          the motion coupling scales with the LED drive, so they start over
+ *          and settle again. Beat and respiration history is kept, rescaled
+ *          to the new IR gain, with the beat chain broken over the settling
+ *          hole.
+ */
+static esp_err_t gain_step(const ppg_agc_t *before) {
+    esp_err_t err = apply_gain();
+
+    ppg_filter_init(&s_filter_ir, (float)algo_ctx.sample_rate);
+    ppg_filter_init(&s_filter_red, (float)algo_ctx.sample_rate);
+    ppg_motion_init(&s_motion, (float)algo_ctx.sample_rate);
+
+    float gain = ppg_agc_gain_ratio(before->ir_pa, before->adc_range, s_agc.ir_pa, s_agc.adc_range);
+    ppg_beat_break(&s_beats);
+    ppg_beat_rescale(&s_beats, gain);
+    ppg_resp_rescale(&s_resp, gain);
+    return err;
+}
+
+/**
+ * @brief Block until the next burst of FIFO samples and feed it to the window
+ * @param finger_lost Set when the raw IR level of the burst says no finger;
+ *                    the burst is then discarded
+ * @return ESP_OK on success (possibly with zero new samples)
+ */
+static esp_err_t acquire_burst(bool *estimate_due, bool *finger_lost) {
+    int32_t red_burst[MAX30102_FIFO_DEPTH];
+    int32_t ir_burst[MAX30102_FIFO_DEPTH];
+    size_t got = 0;
+    uint32_t poll_ms = 0;
+
+    if (s_int_mode) {
+        // Block with no bus traffic until the almost-full interrupt;
+        // the timeout only guards against a missed edge
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MAX30102_INT_TIMEOUT_MS));
+    } else {
+        // Drain before half of the FIFO fills at the configured rate
+        poll_ms = (MAX30102_FIFO_DEPTH / 2) * 1000 / EFFECTIVE_RATE();
+        if (poll_ms > MAX30102_FIFO_POLL_MS) {
+            poll_ms = MAX30102_FIFO_POLL_MS;
+        }
+        vTaskDelay(pdMS_TO_TICKS(poll_ms));
+    }
+
+    uint8_t overflow = 0;
+    esp_err_t err = read_max30102_fifo_burst(I2C_PORT, red_burst, ir_burst,
+                                             MAX30102_FIFO_DEPTH, &got, &overflow);
+    if (err != ESP_OK) {
+        return err;
+    }
+    int64_t t_read = esp_timer_get_time();
+
+    // A_FULL fires every (depth - A_FULL) samples; polling runs on poll_ms
+    int64_t period_us = (int64_t)(algo_ctx.sample_period * 1e6);
+    task_jitter_mark(&s_acq_jitter, t_read, s_int_mode ?
+                     (MAX30102_FIFO_DEPTH - MAX30102_FIFO_A_FULL) * period_us :
+                     (int64_t)poll_ms * 1000);
+
+    s_stats.samples += got;
+    if (got > s_stats.max_burst) {
+        s_stats.max_burst = got;
+    }
+    if (overflow) {
+        // The stream has a gap here; the filters ride through it
+        s_stats.fifo_overflows += overflow;
+        ESP_LOGW(TAG, "FIFO overflow, %u samples lost", overflow);
+    }
+
+    if (got == 0) {
+        return ESP_OK;
+    }
+
+    // Cheapest gate: raw DC of the burst, before any filtering
+    int64_t ir_sum = 0, red_sum = 0;
+    for (size_t i = 0; i < got; i++) {
+        ir_sum += ir_burst[i];
+        red_sum += red_burst[i];
+    }
+    if (!finger_present(ir_sum / got)) {
+        *finger_lost = true;
+        return ESP_OK;
+    }
+
+    // While the filters settle their output is discarded anyway, so the
+    // gain can converge burst by burst right after the finger is placed
+    ppg_agc_t before = s_agc;
+    if (!ppg_filter_settled(&s_filter_ir) &&
+        ppg_agc_update(&s_agc, red_sum / got, ir_sum / got)) {
+        return gain_step(&before);
+    }
+
+    // The newest sample is at most one period old; the rest are spaced back from it
+    int64_t t_sample = t_read - period_us / 2 - (int64_t)(got - 1) * period_us;
+
+    for (size_t i = 0; i < got; i++, t_sample += period_us) {
+        int32_t red = red_burst[i];
+        int32_t ir = ir_burst[i];
+        int32_t red_f, ir_f;
+
+        // Both channels always advance together, so they settle together
+        bool settled = ppg_filter_process(&s_filter_red, red, &red_f);
+        settled &= ppg_filter_process(&s_filter_ir, ir, &ir_f);
+
+#if HEART_RATE_MOTION_CANCEL
+        float accel[PPG_MOTION_AXES];
+        taskENTER_CRITICAL(&s_motion_lock);
+        bool have_accel = ppg_motion_ref_at(&s_motion_ref, t_sample, accel);
+        taskEXIT_CRITICAL(&s_motion_lock);
+
+        // Runs while settling too, so its reference filters settle alongside
+        int32_t red_art = red_f, ir_art = ir_f;
+        ppg_motion_cancel(&s_motion, have_accel ? accel : NULL, &red_f, &ir_f);
+        red -= red_art - red_f;
+        ir -= ir_art - ir_f;
+#endif
+        if (!settled) {
+            continue;
+        }
+        // Respiration lives below the band-pass: the raw IR feeds the baseline series
+        ppg_resp_sample(&s_resp, ir);
+        uint32_t beats_before = s_beats.beats;
+        bool accepted = ppg_beat_process(&s_beats, ir_f);
+        if (s_beats.beats != beats_before) {
+            ppg_resp_beat(&s_resp, &s_beats, accepted);
+        }
+#if HEART_RATE_STREAM_FILTER
+        red = red_f;
+        ir = ir_f;
+#endif
+        if (ppg_window_push(&s_window, red, ir)) {
+            *estimate_due = true;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Sample the FIFO once per HEART_RATE_PROBE_MS while no finger is on
+ * @details Runs at MAX30102_PROBE_LED_PA, so the unworn sensor costs one
+ *          short burst read per period and a fraction of the LED current.
+ */
+static esp_err_t probe_finger(bool *present) {
+    int32_t red_burst[MAX30102_FIFO_DEPTH];
+    int32_t ir_burst[MAX30102_FIFO_DEPTH];
+    size_t got = 0;
+
+    vTaskDelay(pdMS_TO_TICKS(HEART_RATE_PROBE_MS));
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    esp_err_t err = read_max30102_fifo_burst(I2C_PORT, red_burst, ir_burst,
+                                             MAX30102_FIFO_DEPTH, &got, NULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    int64_t ir_sum = 0;
+    for (size_t i = 0; i < got; i++) {
+        ir_sum += ir_burst[i];
+    }
+    *present = (got > 0) && finger_present(ir_sum / got);
+    return ESP_OK;
+}
+
+static void store_latest(const heart_rate_data_t *data) {
+    if (data_mutex) {
+        xSemaphoreTake(data_mutex, portMAX_DELAY);
+        latest_heart_rate = data->heart_rate;
+        latest_spo2 = data->spo2;
+        xSemaphoreGive(data_mutex);
+    }
+}
+
+/**
+ * @brief Report a reading that must not be used (no HR/SpO2/HRV)
+ */
+static esp_err_t report_invalid(heart_rate_data_t *data, ppg_quality_t quality) {
+    memset(data, 0, sizeof(*data));
+    data->valid = false;
+    data->quality = quality;
+
+    store_latest(data);
+    ESP_LOGD(TAG, "Reading invalid: %s", ppg_quality_name(quality));
+    return ESP_OK;
+}
+
+/**
+ * @brief Hand the current window to the compute task
+ * @param quality PPG_QUALITY_NO_FINGER for a frame without samples,
+ *                PPG_QUALITY_GOOD otherwise (the compute task grades it)
+ * @details Never blocks: if both buffers are still owned by the compute
+ *          task the window is skipped and counted, and the stream goes on.
+ * @return false if the frame was dropped
+ */
+static bool publish_frame(ppg_quality_t quality) {
+    uint8_t idx;
+
+    if (xQueueReceive(s_free_q, &idx, 0) != pdPASS) {
+        s_stats.frames_dropped++;
+        return false;
+    }
+
+    ppg_frame_t *frame = &s_frames[idx];
+    frame->quality = quality;
+    frame->resp_due = false;
+    if (quality != PPG_QUALITY_NO_FINGER) {
+#if HEART_RATE_STREAM_FILTER
+        // Already band-limited on arrival; DC comes from the trackers
+        ppg_window_copy(&s_window, frame->ir, frame->red);
+        frame->ir_dc = ppg_filter_dc(&s_filter_ir);
+        frame->red_dc = ppg_filter_dc(&s_filter_red);
+#else
+        // DC and trend come from the window's running sums
+        ppg_window_snapshot(&s_window, frame->ir, frame->red, &frame->ir_dc, &frame->red_dc);
+#endif
+        // The beat detector lives in this task; take its results with the window
+        uint32_t span_ms = (uint32_t)(algo_ctx.window_len * algo_ctx.sample_period * 1000);
+        frame->beat_bpm = ppg_beat_heart_rate(&s_beats, span_ms);
+        frame->beats = ppg_beat_count(&s_beats, span_ms);
+        ppg_beat_hrv(&s_beats, HEART_RATE_HRV_HORIZON_S * 1000, &frame->hrv);
+
+        // The estimate (~37 lags x 3 series x up to 240 points) runs on the
+        // compute task every HEART_RATE_RESP_UPDATE_S; this task only copies
+        // the series, and waits a hop if the last copy is still in use
+        if ((int32_t)(s_resp.n - s_resp_next) >= 0 && !s_resp_snap_busy) {
+            memcpy(&s_resp_snap, &s_resp, sizeof(s_resp_snap));
+            s_resp_snap_busy = true;
+            frame->resp_due = true;
+            s_resp_next = s_resp.n + (uint32_t)(HEART_RATE_RESP_UPDATE_S * algo_ctx.sample_rate);
+        }
+    }
 
-    ESP_LOGI(TAG, "MAX30102 initialized successfully");
+    xQueueSend(s_ready_q, &idx, 0);
+    return true;
+}
+
+/**
+ * @brief One acquisition step: probe, or stream bursts until a window is due
+ * @details Owns the sensor, the sliding window, the filters and the
+ *          auto-gain loop. Each completed hop becomes a frame for the
+ *          compute task, so the FIFO is drained on time however long the
+ *          estimators take.
+ */
+static esp_err_t acquire_window(void) {
+    esp_err_t err;
+
+    if (s_restart_probe) {
+        // The compute task saw no finger in the last window
+        s_restart_probe = false;
+        s_finger_present = false;
+    }
+
+    if (!s_finger_present) {
+        bool present = false;
+        err = probe_finger(&present);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        if (!present) {
+            if (!s_probing &&
+                set_max30102_led_amplitude(I2C_PORT, MAX30102_PROBE_LED_PA,
+                                           MAX30102_PROBE_LED_PA) == ESP_OK) {
+                ESP_LOGI(TAG, "No finger, LED current reduced");
+                s_probing = true;
+            }
+            publish_frame(PPG_QUALITY_NO_FINGER);
+            return ESP_OK;
+        }
+
+        // Resume from the last gain, the same wearer is the likely case
+        ESP_LOGI(TAG, "Finger detected");
+        err = apply_gain();
+        if (err != ESP_OK) {
+            return err;
+        }
+        s_finger_present = true;
+        s_stream_started = false;
+    }
+
+    if (!s_stream_started) {
+        ESP_LOGI(TAG, "Filling window (%d samples, hop %d)...",
+                 algo_ctx.window_len, HEART_RATE_HOP_SAMPLES);
+
+        // Start from an empty FIFO so the window only holds fresh samples
+        err = clear_max30102_fifo(I2C_PORT);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to clear FIFO: %s", esp_err_to_name(err));
+            return err;
+        }
+
+        // Reading the status register releases a stale INT assertion
+        uint8_t int_status = 0;
+        read_max30102_reg(I2C_PORT, REG_INTR_STATUS_1, &int_status, 1);
+        ulTaskNotifyTake(pdTRUE, 0);
+
+        ppg_window_init(&s_window, HEART_RATE_HOP_SAMPLES);
+        ppg_filter_init(&s_filter_ir, (float)algo_ctx.sample_rate);
+        ppg_filter_init(&s_filter_red, (float)algo_ctx.sample_rate);
+        ppg_beat_init(&s_beats, (float)algo_ctx.sample_rate);
+        ppg_resp_init(&s_resp, (float)algo_ctx.sample_rate);
+        s_resp_next = 0;    // The first window replaces the previous wearer's estimate
+        ppg_motion_init(&s_motion, (float)algo_ctx.sample_rate);
+        task_jitter_init(&s_acq_jitter, "ppg_acq");
+        s_stream_started = true;
+    }
+
+    // Stream bursts into the sliding window until the next hop completes
+    bool estimate_due = false;
+    bool finger_lost = false;
+    while (!estimate_due) {
+        err = acquire_burst(&estimate_due, &finger_lost);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (finger_lost) {
+            // Back to probing; the stream restarts once a finger is detected
+            ESP_LOGI(TAG, "Finger removed");
+            s_finger_present = false;
+            s_stream_started = false;
+            publish_frame(PPG_QUALITY_NO_FINGER);
+            return ESP_OK;
+        }
+    }
+
+    if (!publish_frame(PPG_QUALITY_GOOD)) {
+        return ESP_OK;
+    }
+
+    // Between windows only, so no estimator ever sees a gain step: a
+    // change refills the window behind freshly settled filters, and the
+    // frame just sent is still evaluated. Beats and respiration carry on
+    // (HRV and the breathing series span minutes), see gain_step().
+    uint64_t ir_mean, red_mean;
+#if HEART_RATE_STREAM_FILTER
+    ir_mean = ppg_filter_dc(&s_filter_ir);
+    red_mean = ppg_filter_dc(&s_filter_red);
+#else
+    ppg_window_mean(&s_window, &ir_mean, &red_mean);
+#endif
+    ppg_agc_t before = s_agc;
+    if (ppg_agc_update(&s_agc, red_mean, ir_mean)) {
+        err = gain_step(&before);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ppg_window_init(&s_window, HEART_RATE_HOP_SAMPLES);
+    }
     return ESP_OK;
 }
 
+#if HEART_RATE_BENCHMARK
+/**
+ * @brief Run both HR estimators on the same window and log cycles and BPM
+ * @details Debug aid for comparing the autocorrelation and spectral paths
+ *          on real signals; enable with HEART_RATE_BENCHMARK.
+ */
+static void benchmark_estimators(int32_t *ir_buffer) {
+    static uint32_t runs = 0;
+    static uint64_t cycles_acf = 0, cycles_fft = 0;
+    static uint32_t abs_diff_sum = 0;
+    double r0;
+    static double auto_corr_data[BUFFER_SIZE];
+
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    int bpm_acf = calculate_heart_rate(ir_buffer, &r0, auto_corr_data);
+    uint32_t t1 = esp_cpu_get_cycle_count();
+    int bpm_fft = calculate_heart_rate_spectral(ir_buffer);
+    uint32_t t2 = esp_cpu_get_cycle_count();
+
+    runs++;
+    cycles_acf += t1 - t0;
+    cycles_fft += t2 - t1;
+    abs_diff_sum += abs(bpm_acf - bpm_fft);
+
+    ESP_LOGI(TAG, "Bench: autocorr %d BPM %lu cyc | spectral %d BPM %lu cyc | "
+             "avg %llu vs %llu cyc, mean |diff| %.1f BPM over %lu windows",
+             bpm_acf, (unsigned long)(t1 - t0), bpm_fft, (unsigned long)(t2 - t1),
+             (unsigned long long)(cycles_acf / runs), (unsigned long long)(cycles_fft / runs),
+             (float)abs_diff_sum / runs, (unsigned long)runs);
+}
+#endif
+
 esp_err_t heart_rate_read(heart_rate_data_t *data) {
     if (!data) {
         ESP_LOGE(TAG, "Invalid parameter");
         return ESP_ERR_INVALID_ARG;
     }
+    if (!s_ready_q) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    int32_t ir_buffer[MAX30102_BUFFER_SIZE];
-    int32_t red_buffer[MAX30102_BUFFER_SIZE];
-    uint64_t ir_mean, red_mean;
+    static double auto_corr_data[BUFFER_SIZE];
     double r0;
-    double auto_corr_data[MAX30102_BUFFER_SIZE];
+    ppg_quality_metrics_t metrics;
+    uint8_t idx;
 
-    ESP_LOGI(TAG, "Filling buffer (%d samples)...", MAX30102_BUFFER_SIZE);
-
-    // Fill buffer
-    for (int i = 0; i < MAX30102_BUFFER_SIZE; i++) {
-        uint8_t int_status = 0;
+    if (xQueueReceive(s_ready_q, &idx, portMAX_DELAY) != pdPASS) {
+        return ESP_ERR_TIMEOUT;
+    }
+    ppg_frame_t *frame = &s_frames[idx];
 
-        // Wait for PPG_RDY interrupt (bit 6 in REG_INTR_STATUS_1)
-        while (!(int_status & 0x40)) {
-            read_max30102_reg(I2C_PORT, REG_INTR_STATUS_1, &int_status, 1);
-            vTaskDelay(pdMS_TO_TICKS(1));
-        }
+    // Respiration goes on whatever the window grades, the series has its own gaps
+    if (frame->resp_due) {
+        ppg_resp_estimate(&s_resp_snap, &s_resp_result);
+        s_resp_snap_busy = false;
+    }
 
-        // Read FIFO data
-        read_max30102_fifo(I2C_PORT, &red_buffer[i], &ir_buffer[i]);
+    if (frame->quality == PPG_QUALITY_NO_FINGER) {
+        xQueueSend(s_free_q, &idx, 0);
+        return report_invalid(data, PPG_QUALITY_NO_FINGER);
     }
 
-    ESP_LOGI(TAG, "Buffer full. Processing...");
+    // Skip the estimators on windows they cannot use
+    ppg_quality_t quality = ppg_quality_check(frame->ir, frame->red, frame->ir_dc, frame->red_dc,
+                                              &metrics);
+    if (quality != PPG_QUALITY_GOOD) {
+        if (quality == PPG_QUALITY_NO_FINGER) {
+            s_restart_probe = true;
+        }
+        xQueueSend(s_free_q, &idx, 0);
+        return report_invalid(data, quality);
+    }
+    data->valid = true;
+    data->quality = PPG_QUALITY_GOOD;
 
-    // Process data
-    remove_dc_part(ir_buffer, red_buffer, &ir_mean, &red_mean);
-    remove_trend_line(ir_buffer);
-    remove_trend_line(red_buffer);
+#if HEART_RATE_BENCHMARK
+    benchmark_estimators(frame->ir);
+#endif
 
     // Calculate heart rate
-    data->heart_rate = calculate_heart_rate(ir_buffer, &r0, auto_corr_data);
+    if (s_estimator == HR_ESTIMATOR_SPECTRAL) {
+        data->heart_rate = calculate_heart_rate_spectral(frame->ir);
+    } else if (s_estimator == HR_ESTIMATOR_BEATS) {
+        // Mean interval over the same span the window-based estimators see
+        data->heart_rate = frame->beat_bpm;
+    } else {
+        data->heart_rate = calculate_heart_rate(frame->ir, &r0, auto_corr_data);
+    }
 
     // Calculate SpO2
-    data->spo2 = spo2_measurement(ir_buffer, red_buffer, ir_mean, red_mean);
+    data->spo2 = spo2_measurement(frame->ir, frame->red, frame->ir_dc, frame->red_dc);
+
+    // Beat-to-beat variability over the configured horizon
+    data->hrv = frame->hrv;
+    data->resp_rate = s_resp_result.rate_brpm;
+
+    // How far the numbers can be trusted, from what the pipeline already measured
+    metrics.periodicity = ppg_quality_periodicity(frame->ir, data->heart_rate);
+    data->perfusion_index = metrics.perfusion_index;
+    data->beats = (uint16_t)frame->beats;
+    data->confidence = ppg_quality_confidence(&metrics, data->heart_rate, frame->beat_bpm, frame->beats);
+
+    xQueueSend(s_free_q, &idx, 0);
 
     // Update latest values with mutex protection
-    if (data_mutex) {
-        xSemaphoreTake(data_mutex, portMAX_DELAY);
-        latest_heart_rate = data->heart_rate;
-        latest_spo2 = data->spo2;
-        xSemaphoreGive(data_mutex);
-    }
+    store_latest(data);
 
-    ESP_LOGI(TAG, "Heart Rate: %d BPM, SpO2: %.2f%%", data->heart_rate, data->spo2);
+    ESP_LOGD(TAG, "PI %.2f%%, confidence %u, Heart Rate: %d BPM, SpO2: %.2f%%, SDNN %.1f ms, RMSSD %.1f ms (%u RR)",
+             data->perfusion_index, data->confidence, data->heart_rate, data->spo2, data->hrv.sdnn_ms, data->hrv.rmssd_ms, data->hrv.intervals);
     return ESP_OK;
 }
 
+/**
+ * @brief Acquisition task: drains the FIFO on every A_FULL and fills frames
+ */
+static void heart_rate_acq_task(void *param) {
+    s_acq_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        esp_err_t err = acquire_window();
+
+        if (err != ESP_OK) {
+            // Restart the stream from an empty window after a bus error
+            ESP_LOGE(TAG, "FIFO read failed: %s", esp_err_to_name(err));
+            s_stream_started = false;
+            vTaskDelay(pdMS_TO_TICKS(MAX30102_INT_TIMEOUT_MS));
+        }
+    }
+}
+
+/**
+ * @brief Compute task: evaluates each completed frame and reports it
+ */
 static void heart_rate_task(void *param) {
     void (*callback)(heart_rate_data_t) = (void (*)(heart_rate_data_t))param;
 
@@ -144,27 +739,86 @@ static void heart_rate_task(void *param) {
         if (err == ESP_OK && callback) {
             callback(data);
         }
-
-        vTaskDelay(pdMS_TO_TICKS(HEART_READ_DELAY_MS));
     }
 }
 
 esp_err_t heart_rate_start_task(void (*callback)(heart_rate_data_t data)) {
-    BaseType_t ret = xTaskCreate(
-        heart_rate_task,
-        "heart_rate_task",
-        6144,
-        (void*)callback,
-        5,
-        NULL
-    );
-
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create heart rate task");
+    if (!s_free_q) {
+        s_free_q = xQueueCreate(PPG_FRAME_COUNT, sizeof(uint8_t));
+        s_ready_q = xQueueCreate(PPG_FRAME_COUNT, sizeof(uint8_t));
+        if (!s_free_q || !s_ready_q) {
+            ESP_LOGE(TAG, "Failed to create frame queues");
+            return ESP_ERR_NO_MEM;
+        }
+        for (uint8_t i = 0; i < PPG_FRAME_COUNT; i++) {
+            xQueueSend(s_free_q, &i, 0);
+        }
+    }
+
+    // Compute first, so the first frame always finds its consumer
+    esp_err_t err = task_map_create(TASK_PPG_DSP, heart_rate_task, (void*)callback, NULL);
+    if (err == ESP_OK) {
+        err = task_map_create(TASK_PPG_ACQ, heart_rate_acq_task, NULL, NULL);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create heart rate tasks");
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "Heart rate task started");
+    ESP_LOGI(TAG, "Heart rate tasks started");
+    return ESP_OK;
+}
+
+void heart_rate_get_stats(heart_rate_stats_t *stats) {
+    // Single writer (the acquisition task); fields may be one burst apart
+    *stats = s_stats;
+}
+
+void heart_rate_push_motion(int64_t t_us, float ax, float ay, float az) {
+    taskENTER_CRITICAL(&s_motion_lock);
+    ppg_motion_ref_push(&s_motion_ref, t_us, ax, ay, az);
+    taskEXIT_CRITICAL(&s_motion_lock);
+}
+
+void heart_rate_set_estimator(hr_estimator_t estimator) {
+    s_estimator = estimator;
+}
+
+/**
+ * @brief Find the SPO2_SR/SMP_AVE pair giving an effective rate
+ */
+static bool find_rate_codes(uint16_t rate_hz, uint8_t *sr_out, uint8_t *ave_out) {
+    // Prefer 4x averaging (best SNR per LED pulse), then the nearest factors
+    static const uint8_t ave_preference[] = {0b010, 0b001, 0b011, 0b000, 0b100, 0b101};
+
+    for (size_t a = 0; a < sizeof(ave_preference); a++) {
+        uint8_t ave = ave_preference[a];
+        for (uint8_t sr = 0; sr <= MAX_ADC_RATE_CODE; sr++) {
+            if (k_adc_rates[sr] == (uint32_t)rate_hz * k_averaging[ave]) {
+                *sr_out = sr;
+                *ave_out = ave;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool heart_rate_sample_rate_supported(uint16_t rate_hz) {
+    uint8_t sr, ave;
+    return find_rate_codes(rate_hz, &sr, &ave);
+}
+
+esp_err_t heart_rate_set_sample_rate(uint16_t rate_hz) {
+    if (!find_rate_codes(rate_hz, &s_spo2_sr, &s_smp_ave)) {
+        ESP_LOGW(TAG, "Unsupported sample rate %u Hz", rate_hz);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    s_rate_selected = true;
+    ESP_LOGI(TAG, "Sample rate %u Hz (%u sps / %u)", rate_hz,
+             k_adc_rates[s_spo2_sr], k_averaging[s_smp_ave]);
     return ESP_OK;
 }
 
@@ -3,29 +3,99 @@
 
 #include "esp_err.h"
 #include "sytem_config.h"
+#include "algorithm.h"
+#include "ppg_beat.h"
+#include "ppg_quality.h"
 
 typedef struct {
+    bool valid;             // false: no finger / poor signal, values are 0
+    ppg_quality_t quality;
     int heart_rate;
     double spo2;
+    ppg_hrv_t hrv;          // Over the last HEART_RATE_HRV_HORIZON_S seconds
+    float resp_rate;        // Breaths per minute over up to PPG_RESP_SPAN_S (0 = not available)
+    float perfusion_index;  // IR AC peak-to-peak / DC (%)
+    uint8_t confidence;     // 0-100 from ppg_quality_confidence(), 0 when !valid
+    uint16_t beats;         // Accepted beat intervals within the window span
 } heart_rate_data_t;
 
+/**
+ * @brief Acquisition health counters since boot
+ */
+typedef struct {
+    uint32_t samples;           // FIFO samples read
+    uint32_t fifo_overflows;    // Samples lost to FIFO overflow (OVF_COUNTER)
+    uint32_t frames_dropped;    // Windows skipped while the compute task was busy
+    uint32_t max_burst;         // Largest burst read (MAX30102_FIFO_DEPTH = FIFO was full)
+} heart_rate_stats_t;
+
 /**
  * @brief Initialize heart rate sensor (MAX30102)
  */
 esp_err_t heart_rate_sensor_init(void);
 
 /**
- * @brief Read heart rate and SpO2
+ * @brief Wait for the next window from the acquisition task and evaluate it
  * @param data Pointer to store heart rate data
+ * @details Without a finger the sensor is probed once per HEART_RATE_PROBE_MS
+ *          at reduced LED current and data->valid is false; the same holds
+ *          for windows rejected by the signal-quality gate.
+ * @return ESP_ERR_INVALID_STATE before heart_rate_start_task()
+ * @note Called by the compute task; one caller at a time
  */
 esp_err_t heart_rate_read(heart_rate_data_t *data);
 
 /**
- * @brief Start heart rate reading task
- * @param callback Function to call with heart rate data
+ * @brief Start the acquisition and compute tasks
+ * @param callback Function to call with heart rate data (compute task)
+ * @details The acquisition task (TASK_PPG_ACQ) only drains the FIFO,
+ *          filters and fills one of two frame buffers per hop; the compute
+ *          task (TASK_PPG_DSP, on the other core) runs the quality gate and
+ *          estimators on the completed one. A long estimate therefore never
+ *          delays a FIFO read.
  */
 esp_err_t heart_rate_start_task(void (*callback)(heart_rate_data_t data));
 
+/**
+ * @brief Copy the acquisition counters (FIFO overflows, dropped frames)
+ */
+void heart_rate_get_stats(heart_rate_stats_t *stats);
+
+/**
+ * @brief Select the heart rate estimator used by heart_rate_read()
+ * @param estimator HR_ESTIMATOR_AUTOCORRELATION, HR_ESTIMATOR_SPECTRAL or
+ *                  HR_ESTIMATOR_BEATS
+ * @note Defaults to HEART_RATE_ESTIMATOR; call before heart_rate_start_task()
+ */
+void heart_rate_set_estimator(hr_estimator_t estimator);
+
+/**
+ * @brief Feed one accelerometer sample as the motion-artifact reference
+ * @param t_us Time the sample was taken (esp_timer_get_time() base)
+ * @param ax, ay, az Acceleration in g
+ * @details Safe to call from any task; samples drained from the IMU FIFO
+ *          in a batch go in oldest first with their own times. With
+ *          HEART_RATE_MOTION_CANCEL the red/IR streams are cleaned against
+ *          the reading interpolated at each PPG sample time; without recent
+ *          readings they pass through unchanged.
+ * @note Needs at least ~2x the heart rate band (>= 10 Hz) to be useful
+ */
+void heart_rate_push_motion(int64_t t_us, float ax, float ay, float az);
+
+/**
+ * @brief Select the effective PPG sample rate (ADC rate / on-chip averaging)
+ * @param rate_hz Effective rate, e.g. 25, 50 or 100 Hz
+ * @return ESP_OK, or ESP_ERR_NOT_SUPPORTED if no SPO2_SR/SMP_AVE pair gives it
+ * @note Defaults to HEART_RATE_SAMPLE_RATE_HZ; applied by the next
+ *       heart_rate_sensor_init(), which also rebuilds the algorithm context
+ */
+esp_err_t heart_rate_set_sample_rate(uint16_t rate_hz);
+
+/**
+ * @brief Check a rate for heart_rate_set_sample_rate() without selecting it
+ */
+bool heart_rate_sample_rate_supported(uint16_t rate_hz);
+
 /**
  * @brief Get latest heart rate reading
  */
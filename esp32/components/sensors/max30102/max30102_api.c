@@ -50,6 +50,106 @@ void read_max30102_fifo(i2c_port_t i2c_num, int32_t *red_data, int32_t *ir_data)
 }
 
 
+/*
+ * Returns how many samples are waiting in the FIFO. WR_PTR, OVF_COUNTER and
+ * RD_PTR are consecutive registers, so one transaction reads all three.
+ * A non-zero overflow counter means the FIFO wrapped and is full; it counts
+ * the samples lost since the last read (saturating at 31) and is cleared by
+ * the chip when the read pointer next advances.
+ */
+esp_err_t get_max30102_fifo_count(i2c_port_t i2c_num, size_t *pending, uint8_t *overflow)
+{
+	uint8_t ptr[3];
+	uint8_t reg = REG_FIFO_WR_PTR;
+
+	esp_err_t err = i2c_sensor_write(i2c_num, &reg, 1);
+	if (err == ESP_OK) {
+		err = i2c_sensor_read(i2c_num, ptr, sizeof(ptr));
+	}
+	if (err != ESP_OK) {
+		return err;
+	}
+
+	uint8_t wr_ptr = ptr[0] & 0x1F;
+	uint8_t ovf    = ptr[1] & 0x1F;
+	uint8_t rd_ptr = ptr[2] & 0x1F;
+
+	*pending = (wr_ptr - rd_ptr) & (MAX30102_FIFO_DEPTH - 1);
+	if (*pending == 0 && ovf != 0) {
+		*pending = MAX30102_FIFO_DEPTH;
+	}
+	if (overflow) {
+		*overflow = ovf;
+	}
+	return ESP_OK;
+}
+
+
+/*
+ * Drains every pending sample (up to max_samples) with a single multi-byte
+ * read of REG_FIFO_DATA instead of one 6-byte transaction per sample.
+ */
+esp_err_t read_max30102_fifo_burst(i2c_port_t i2c_num, int32_t *red_data, int32_t *ir_data, size_t max_samples, size_t *samples_read, uint8_t *overflow)
+{
+	uint8_t raw[MAX30102_FIFO_DEPTH * MAX30102_SAMPLE_BYTES];
+	uint8_t fifo_reg = REG_FIFO_DATA;
+	size_t pending = 0;
+
+	*samples_read = 0;
+
+	esp_err_t err = get_max30102_fifo_count(i2c_num, &pending, overflow);
+	if (err != ESP_OK) {
+		return err;
+	}
+	if (pending > max_samples) {
+		pending = max_samples;
+	}
+	if (pending == 0) {
+		return ESP_OK;
+	}
+
+	err = i2c_sensor_write(i2c_num, &fifo_reg, 1);
+	if (err == ESP_OK) {
+		err = i2c_sensor_read(i2c_num, raw, pending * MAX30102_SAMPLE_BYTES);
+	}
+	if (err != ESP_OK) {
+		return err;
+	}
+
+	for (size_t i = 0; i < pending; i++) {
+		const uint8_t *s = &raw[i * MAX30102_SAMPLE_BYTES];
+		red_data[i] = (int32_t)((s[0] & 0x03) << 16) | (s[1] << 8) | s[2];
+		ir_data[i]  = (int32_t)((s[3] & 0x03) << 16) | (s[4] << 8) | s[5];
+	}
+
+	*samples_read = pending;
+	return ESP_OK;
+}
+
+
+/*
+ * Discards stale samples so the next window starts with fresh data.
+ */
+esp_err_t clear_max30102_fifo(i2c_port_t i2c_num)
+{
+	if (write_max30102_reg(i2c_num, 0, REG_FIFO_WR_PTR) != ESP_OK) return ESP_ERR_NOT_FINISHED;
+	if (write_max30102_reg(i2c_num, 0, REG_OVF_COUNTER) != ESP_OK) return ESP_ERR_NOT_FINISHED;
+	if (write_max30102_reg(i2c_num, 0, REG_FIFO_RD_PTR) != ESP_OK) return ESP_ERR_NOT_FINISHED;
+	return ESP_OK;
+}
+
+
+/*
+ * LED1 is the red LED and LED2 the IR LED; 0.2 mA per step.
+ */
+esp_err_t set_max30102_led_amplitude(i2c_port_t i2c_num, uint8_t red_pa, uint8_t ir_pa)
+{
+	if (write_max30102_reg(i2c_num, red_pa, REG_LED1_PA) != ESP_OK) return ESP_ERR_NOT_FINISHED;
+	if (write_max30102_reg(i2c_num, ir_pa, REG_LED2_PA) != ESP_OK) return ESP_ERR_NOT_FINISHED;
+	return ESP_OK;
+}
+
+
 void read_max30102_reg(i2c_port_t i2c_num, uint8_t reg_addr, uint8_t *data_reg, size_t bytes_to_read)
 {
 	i2c_sensor_write(i2c_num, &reg_addr, 1);
@@ -29,6 +29,9 @@
 #define REG_REV_ID 0xFE
 #define REG_PART_ID 0xFF
 
+#define MAX30102_FIFO_DEPTH 32      // Samples the FIFO can hold
+#define MAX30102_SAMPLE_BYTES 6     // 3 bytes RED + 3 bytes IR (SpO2 mode)
+
 
 typedef struct{
 	union{
@@ -152,6 +155,10 @@ esp_err_t max30102_init(i2c_port_t i2c_num, max_config *configuration);
 esp_err_t write_max30102_reg(i2c_port_t i2c_num, uint8_t command, uint8_t reg);
 //void read_max30102_fifo(uint32_t *red_data, uint32_t *ir_data);
 void read_max30102_fifo(i2c_port_t i2c_num, int32_t *red_data, int32_t *ir_data);
+esp_err_t get_max30102_fifo_count(i2c_port_t i2c_num, size_t *pending, uint8_t *overflow);
+esp_err_t read_max30102_fifo_burst(i2c_port_t i2c_num, int32_t *red_data, int32_t *ir_data, size_t max_samples, size_t *samples_read, uint8_t *overflow);
+esp_err_t clear_max30102_fifo(i2c_port_t i2c_num);
+esp_err_t set_max30102_led_amplitude(i2c_port_t i2c_num, uint8_t red_pa, uint8_t ir_pa);
 float get_max30102_temp(i2c_port_t i2c_num);
 void read_max30102_reg(i2c_port_t i2c_num, uint8_t reg_addr, uint8_t *data_reg, size_t bytes_to_read);
 
@@ -0,0 +1,64 @@
+#include "ppg_agc.h"
+
+
+static bool adjust_channel(uint8_t *pa, uint64_t dc, bool *want_more, bool *want_less)
+{
+	if (dc >= PPG_AGC_DC_LOW && dc <= PPG_AGC_DC_HIGH) {
+		return false;
+	}
+
+	// Proportional step straight to the target, rounded
+	uint64_t scaled = (dc == 0) ? PPG_AGC_PA_MAX : ((uint64_t)*pa * PPG_AGC_DC_TARGET + dc / 2) / dc;
+	if (scaled < PPG_AGC_PA_MIN) scaled = PPG_AGC_PA_MIN;
+	if (scaled > PPG_AGC_PA_MAX) scaled = PPG_AGC_PA_MAX;
+
+	if (scaled == *pa) {
+		// Pinned at a limit: only the ADC range can help
+		if (dc < PPG_AGC_DC_LOW) *want_more = true;
+		else *want_less = true;
+		return false;
+	}
+	*pa = (uint8_t)scaled;
+	return true;
+}
+
+
+bool ppg_agc_update(ppg_agc_t *agc, uint64_t red_dc, uint64_t ir_dc)
+{
+	bool want_more = false, want_less = false;
+	bool changed = adjust_channel(&agc->red_pa, red_dc, &want_more, &want_less);
+	changed |= adjust_channel(&agc->ir_pa, ir_dc, &want_more, &want_less);
+
+	// Saturation wins over a weak channel
+	if (want_less && agc->adc_range < PPG_AGC_RANGE_MAX) {
+		agc->adc_range++;
+		changed = true;
+	} else if (want_more && !want_less && agc->adc_range > 0) {
+		agc->adc_range--;
+		changed = true;
+	}
+	return changed;
+}
+
+
+uint64_t ppg_agc_normalize(uint64_t dc, uint8_t pa, uint8_t range, uint8_t ref_pa, uint8_t ref_range)
+{
+	if (pa == 0) {
+		return 0;
+	}
+	dc = dc * ref_pa / pa;
+	// A larger full scale gives fewer counts for the same photocurrent
+	return (range >= ref_range) ? (dc << (range - ref_range)) : (dc >> (ref_range - range));
+}
+
+
+float ppg_agc_gain_ratio(uint8_t pa_before, uint8_t range_before, uint8_t pa_after, uint8_t range_after)
+{
+	if (pa_before == 0) {
+		return 1.0f;
+	}
+	float ratio = (float)pa_after / pa_before;
+	// Each range step up halves the counts
+	return (range_after >= range_before) ? ratio / (float)(1u << (range_after - range_before))
+	                                     : ratio * (float)(1u << (range_before - range_after));
+}
@@ -0,0 +1,48 @@
+#ifndef PPG_AGC_H
+#define PPG_AGC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PPG_AGC_DC_LOW      80000   // Hysteresis band for the raw DC (18-bit counts)
+#define PPG_AGC_DC_HIGH     200000
+#define PPG_AGC_DC_TARGET   110000  // Low in the band: least LED current that stays in it
+#define PPG_AGC_PA_MIN      0x02    // 0.4 mA
+#define PPG_AGC_PA_MAX      0xFF    // 51 mA
+#define PPG_AGC_RANGE_MAX   0b11    // SPO2_ADC_RGE 16384 nA full scale
+
+/**
+ * @brief LED drive and ADC range chosen by the auto-gain loop
+ */
+typedef struct {
+    uint8_t red_pa;         // LED1_PA
+    uint8_t ir_pa;          // LED2_PA
+    uint8_t adc_range;      // SPO2_ADC_RGE code (2048 nA << code full scale)
+} ppg_agc_t;
+
+/**
+ * @brief One auto-gain step from the DC level of each channel
+ * @details A channel whose DC is inside PPG_AGC_DC_LOW..PPG_AGC_DC_HIGH is
+ *          left alone, so a settled loop never touches the sensor. Outside
+ *          the band its LED amplitude is scaled to land on
+ *          PPG_AGC_DC_TARGET, since the DC count is proportional to the LED
+ *          current. Only when a channel is pinned at an amplitude limit is
+ *          the shared ADC range stepped (one step doubles or halves every
+ *          count).
+ * @return true if any setting changed and must be written to the sensor
+ */
+bool ppg_agc_update(ppg_agc_t *agc, uint64_t red_dc, uint64_t ir_dc);
+
+/**
+ * @brief Express a DC count as it would read at a reference LED amplitude and range
+ * @details Lets fixed thresholds (e.g. finger presence) work at any gain.
+ */
+uint64_t ppg_agc_normalize(uint64_t dc, uint8_t pa, uint8_t range, uint8_t ref_pa, uint8_t ref_range);
+
+/**
+ * @brief Factor a gain step scales the counts of a channel by
+ * @return Counts after / counts before, for the same photocurrent
+ */
+float ppg_agc_gain_ratio(uint8_t pa_before, uint8_t range_before, uint8_t pa_after, uint8_t range_after);
+
+#endif
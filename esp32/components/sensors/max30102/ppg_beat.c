@@ -0,0 +1,226 @@
+#include <math.h>
+#include <string.h>
+#include "ppg_beat.h"
+#include "algorithm.h"
+
+#define PEAK_LEVEL_ALPHA 0.125f     // Running systolic amplitude EMA
+#define THRESHOLD_RATIO  0.7f       // Candidate rise must exceed this * peak_level
+#define BLANKING_RATIO   0.6f       // No candidate before this * mean interval
+
+
+void ppg_beat_init(ppg_beat_t *b, float sample_rate)
+{
+	memset(b, 0, sizeof(*b));
+
+	b->ms_per_sample = 1000.0f / sample_rate;
+	b->refractory = (uint32_t)(sample_rate * 60.0f / HR_MAX_BPM);
+	b->lost = (uint32_t)(sample_rate * 60.0f / HR_MIN_BPM * 2.0f);
+	b->rr_min_ms = 60000 / HR_MAX_BPM;
+	b->rr_max_ms = 60000 / HR_MIN_BPM;
+}
+
+
+static void push_rr(ppg_beat_t *b, uint16_t rr_ms)
+{
+	// Consecutive gap markers carry no information
+	if (rr_ms == 0 && b->count > 0 && b->rr[(b->head + PPG_BEAT_RR_CAPACITY - 1) % PPG_BEAT_RR_CAPACITY] == 0) {
+		return;
+	}
+
+	b->rr[b->head] = rr_ms;
+	b->head = (b->head + 1) % PPG_BEAT_RR_CAPACITY;
+	if (b->count < PPG_BEAT_RR_CAPACITY) {
+		b->count++;
+	}
+}
+
+
+static bool confirm_candidate(ppg_beat_t *b)
+{
+	bool accepted = false;
+
+	if (b->have_last) {
+		float rr = ((float)(b->cand_n - b->last_n) + (b->cand_frac - b->last_frac)) * b->ms_per_sample;
+		if (rr >= b->rr_min_ms && rr <= b->rr_max_ms) {
+			push_rr(b, (uint16_t)lroundf(rr));
+			float rr_samples = rr / b->ms_per_sample;
+			b->rr_mean = (b->rr_mean == 0) ? rr_samples : b->rr_mean + PEAK_LEVEL_ALPHA * (rr_samples - b->rr_mean);
+			accepted = true;
+		} else {
+			push_rr(b, 0);
+		}
+	}
+
+	b->peak_level += PEAK_LEVEL_ALPHA * (b->cand_amp - b->peak_level);
+	b->have_last = true;
+	b->last_n = b->cand_n;
+	b->last_frac = b->cand_frac;
+	b->have_candidate = false;
+	b->beats++;
+	return accepted;
+}
+
+
+bool ppg_beat_process(ppg_beat_t *b, int32_t filtered_ir)
+{
+	// Absorption rises at systole, so the systolic peak is a minimum of IR
+	float x = -(float)filtered_ir;
+	bool beat = false;
+
+	// Blanking after a beat rejects the dicrotic wave at normal rates
+	float blanking = BLANKING_RATIO * b->rr_mean;
+	if (blanking < b->refractory) blanking = b->refractory;
+	bool blanked = b->have_last && (float)(b->n - 1 - b->last_n) < blanking;
+
+	// Amplitude from the preceding trough, so residual wander does not matter
+	float amp = b->x1 - b->trough;
+
+	if (b->n >= 2 && !blanked && b->x1 > b->x2 && b->x1 >= x &&
+	    amp > THRESHOLD_RATIO * b->peak_level) {
+		if (!b->have_candidate || b->x1 > b->cand_val) {
+			float denom = b->x2 - 2.0f * b->x1 + x;
+			float frac = (denom != 0) ? 0.5f * (b->x2 - x) / denom : 0;
+			if (frac > 0.5f) frac = 0.5f;
+			if (frac < -0.5f) frac = -0.5f;
+
+			b->have_candidate = true;
+			b->cand_n = b->n - 1;
+			b->cand_frac = frac;
+			b->cand_val = b->x1;
+			b->cand_amp = amp;
+			b->trough = x;
+		}
+	}
+
+	if (b->have_candidate && (b->n - b->cand_n) >= b->refractory) {
+		beat = confirm_candidate(b);
+	}
+
+	// No beat for too long: let the threshold recover and restart the chain
+	if (!b->have_candidate && (b->n - b->last_n) > b->lost) {
+		b->peak_level *= 0.5f;
+		b->rr_mean = 0;
+		if (b->have_last) {
+			push_rr(b, 0);
+			b->have_last = false;
+		}
+		b->last_n = b->n;
+	}
+
+	if (b->n == 0 || x < b->trough) {
+		b->trough = x;
+	}
+	b->x2 = b->x1;
+	b->x1 = x;
+	b->n++;
+	return beat;
+}
+
+
+void ppg_beat_break(ppg_beat_t *b)
+{
+	b->have_candidate = false;
+	if (b->have_last) {
+		push_rr(b, 0);
+		b->have_last = false;
+	}
+	b->last_n = b->n;
+}
+
+
+void ppg_beat_rescale(ppg_beat_t *b, float gain)
+{
+	b->x1 *= gain;
+	b->x2 *= gain;
+	b->trough *= gain;
+	b->peak_level *= gain;
+	b->cand_val *= gain;
+	b->cand_amp *= gain;
+}
+
+
+void ppg_beat_hrv(const ppg_beat_t *b, uint32_t horizon_ms, ppg_hrv_t *hrv)
+{
+	uint32_t span = 0;
+	uint32_t n = 0, diffs = 0, nn50 = 0;
+	float sum = 0, sum2 = 0, sum_d2 = 0;
+	uint16_t newer = 0;
+	uint16_t ref = 0;       // Shift for the variance sums (float cancellation)
+
+	memset(hrv, 0, sizeof(*hrv));
+
+	// Walk back from the newest interval until the horizon is covered
+	for (uint16_t k = 0; k < b->count && span < horizon_ms; k++) {
+		uint16_t rr = b->rr[(b->head + PPG_BEAT_RR_CAPACITY - 1 - k) % PPG_BEAT_RR_CAPACITY];
+
+		if (rr != 0) {
+			if (n == 0) {
+				ref = rr;
+				hrv->last_rr_ms = (k == 0) ? rr : 0;
+			}
+			float dev = (float)rr - ref;
+			span += rr;
+			n++;
+			sum += dev;
+			sum2 += dev * dev;
+			if (newer != 0) {
+				float d = (float)newer - rr;
+				sum_d2 += d * d;
+				diffs++;
+				if (fabsf(d) > PPG_BEAT_NN50_MS) {
+					nn50++;
+				}
+			}
+		}
+		newer = rr;
+	}
+
+	hrv->intervals = n;
+	if (n >= 2) {
+		float mean = sum / n;
+		float var = sum2 / n - mean * mean;
+		hrv->sdnn_ms = (var > 0) ? sqrtf(var) : 0;
+	}
+	if (diffs > 0) {
+		hrv->rmssd_ms = sqrtf(sum_d2 / diffs);
+		hrv->pnn50 = 100.0f * nn50 / diffs;
+	}
+}
+
+
+int ppg_beat_heart_rate(const ppg_beat_t *b, uint32_t span_ms)
+{
+	uint32_t span = 0, n = 0;
+
+	for (uint16_t k = 0; k < b->count && span < span_ms; k++) {
+		uint16_t rr = b->rr[(b->head + PPG_BEAT_RR_CAPACITY - 1 - k) % PPG_BEAT_RR_CAPACITY];
+		if (rr != 0) {
+			span += rr;
+			n++;
+		}
+	}
+
+	if (n < 2) {
+		return 333;
+	}
+	return (int)((60000UL * n + span / 2) / span);
+}
+
+
+int ppg_beat_count(const ppg_beat_t *b, uint32_t span_ms)
+{
+	uint32_t span = 0;
+	int n = 0;
+
+	for (uint16_t k = 0; k < b->count; k++) {
+		uint16_t rr = b->rr[(b->head + PPG_BEAT_RR_CAPACITY - 1 - k) % PPG_BEAT_RR_CAPACITY];
+		if (rr != 0) {
+			span += rr;
+			if (span > span_ms) {
+				break;
+			}
+			n++;
+		}
+	}
+	return n;
+}
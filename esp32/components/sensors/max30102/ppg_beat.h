@@ -0,0 +1,111 @@
+#ifndef PPG_BEAT_H
+#define PPG_BEAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PPG_BEAT_RR_CAPACITY 256    // Inter-beat intervals kept (~2 min at 120 BPM)
+#define PPG_BEAT_NN50_MS     50     // pNN50 threshold
+
+/**
+ * @brief HRV metrics over the most recent inter-beat intervals
+ */
+typedef struct {
+    float sdnn_ms;          // Standard deviation of the intervals
+    float rmssd_ms;         // Root mean square of successive differences
+    float pnn50;            // % of successive differences > 50 ms
+    uint16_t last_rr_ms;    // Most recent interval (0 = none yet)
+    uint16_t intervals;     // Intervals behind the metrics
+} ppg_hrv_t;
+
+/**
+ * @brief Systolic peak detector on the band-passed IR stream
+ * @details Works one sample at a time on the ppg_filter output. A local
+ *          maximum that rises more than 70 % of the running trough-to-peak
+ *          amplitude above the preceding trough becomes a candidate; the
+ *          largest candidate within the refractory period (60 / HR_MAX_BPM)
+ *          is the beat. Candidates are blanked for 60 % of the running
+ *          interval after a beat so the dicrotic wave is not counted. Beat
+ *          times are refined with a parabola through the three samples
+ *          around the peak, which matters for RMSSD at 25-50 Hz where one
+ *          sample is 20-40 ms.
+ *
+ *          Intervals outside HR_MIN_BPM..HR_MAX_BPM are dropped and break
+ *          the chain; a 0 is stored in the ring as a gap marker so no
+ *          successive difference is taken across it.
+ */
+typedef struct {
+    float ms_per_sample;
+    uint32_t refractory;    // Samples
+    uint32_t lost;          // Samples without a beat before the chain resets
+    uint16_t rr_min_ms;
+    uint16_t rr_max_ms;
+
+    uint32_t n;             // Sample counter
+    float x1, x2;           // Previous two samples (x1 = n-1)
+    float trough;           // Minimum since the last candidate
+    float peak_level;       // Running trough-to-peak amplitude
+    float rr_mean;          // Running interval in samples (0 = unknown)
+
+    bool have_candidate;
+    uint32_t cand_n;
+    float cand_frac;
+    float cand_val;
+    float cand_amp;
+
+    bool have_last;
+    uint32_t last_n;
+    float last_frac;
+
+    uint16_t rr[PPG_BEAT_RR_CAPACITY];
+    uint16_t head;          // Next slot to write
+    uint16_t count;
+    uint32_t beats;         // Beats detected since init
+} ppg_beat_t;
+
+/**
+ * @brief Reset the detector for a sample rate
+ */
+void ppg_beat_init(ppg_beat_t *b, float sample_rate);
+
+/**
+ * @brief Feed one band-passed IR sample
+ * @return true when a beat was confirmed on this sample
+ */
+bool ppg_beat_process(ppg_beat_t *b, int32_t filtered_ir);
+
+/**
+ * @brief The stream was interrupted (samples skipped, gain changed)
+ * @details Drops a pending candidate and breaks the chain, so the next
+ *          beat starts a new one instead of closing an interval across the
+ *          hole. Intervals and the running amplitude are kept.
+ */
+void ppg_beat_break(ppg_beat_t *b);
+
+/**
+ * @brief Rescale the amplitude state after the input gain changed
+ * @param gain New counts / old counts (ppg_agc_gain_ratio())
+ * @details Without it a step down below THRESHOLD_RATIO would reject every
+ *          beat until the lost timeout, a step up would let noise through.
+ */
+void ppg_beat_rescale(ppg_beat_t *b, float gain);
+
+/**
+ * @brief HRV metrics over the intervals of the last horizon_ms
+ */
+void ppg_beat_hrv(const ppg_beat_t *b, uint32_t horizon_ms, ppg_hrv_t *hrv);
+
+/**
+ * @brief Heart rate from the mean interval of the last span_ms
+ * @return BPM, or 333 (the estimators' no-peak sentinel) with < 2 intervals
+ */
+int ppg_beat_heart_rate(const ppg_beat_t *b, uint32_t span_ms);
+
+/**
+ * @brief Accepted intervals that end within the last span_ms
+ * @details Walks back the same way as ppg_beat_heart_rate(), so at a
+ *          steady rate the count is span_ms / RR.
+ */
+int ppg_beat_count(const ppg_beat_t *b, uint32_t span_ms);
+
+#endif
@@ -0,0 +1,119 @@
+#include <string.h>
+#include "ppg_calib.h"
+
+#define Q16(x)          ((int32_t)((x) * 65536.0 + 0.5))
+#define LINE_R(spo2)    ((104.0f - (spo2)) / 17.0f)
+
+
+typedef struct {
+	ppg_calib_table_t t;
+	int32_t r_q16[PPG_CALIB_MAX_POINTS];
+	int32_t spo2_q16[PPG_CALIB_MAX_POINTS];
+} calib_slot_t;
+
+static const calib_slot_t k_default = {
+	.t = {
+		.version = PPG_CALIB_VERSION,
+		.count = 7,
+		.lot = "default",
+		.r = {LINE_R(100), LINE_R(95), LINE_R(90), LINE_R(85), LINE_R(80), LINE_R(75), LINE_R(70)},
+		.spo2 = {100, 95, 90, 85, 80, 75, 70},
+	},
+	.r_q16 = {Q16(LINE_R(100)), Q16(LINE_R(95)), Q16(LINE_R(90)), Q16(LINE_R(85)),
+	          Q16(LINE_R(80)), Q16(LINE_R(75)), Q16(LINE_R(70))},
+	.spo2_q16 = {Q16(100), Q16(95), Q16(90), Q16(85), Q16(80), Q16(75), Q16(70)},
+};
+
+static calib_slot_t s_slots[2];
+static const calib_slot_t *volatile s_active = &k_default;
+
+
+void ppg_calib_default(ppg_calib_table_t *t)
+{
+	*t = k_default.t;
+}
+
+
+bool ppg_calib_validate(const ppg_calib_table_t *t)
+{
+	if (t->version != PPG_CALIB_VERSION || t->count < 2 || t->count > PPG_CALIB_MAX_POINTS) {
+		return false;
+	}
+	for (int i = 0; i < t->count; i++) {
+		// The negated tests also reject NaN
+		if (!(t->r[i] > 0.0f) || (i > 0 && !(t->r[i] > t->r[i - 1]))) {
+			return false;
+		}
+		if (!(t->spo2[i] >= PPG_CALIB_SPO2_MIN && t->spo2[i] <= PPG_CALIB_SPO2_MAX)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool ppg_calib_set(const ppg_calib_table_t *t)
+{
+	if (!ppg_calib_validate(t)) {
+		return false;
+	}
+
+	calib_slot_t *slot = (s_active == &s_slots[0]) ? &s_slots[1] : &s_slots[0];
+	slot->t = *t;
+	slot->t.lot[PPG_CALIB_LOT_LEN - 1] = '\0';
+	for (int i = 0; i < t->count; i++) {
+		slot->r_q16[i] = Q16(t->r[i]);
+		slot->spo2_q16[i] = Q16(t->spo2[i]);
+	}
+	s_active = slot;
+	return true;
+}
+
+
+const ppg_calib_table_t *ppg_calib_get(void)
+{
+	return &s_active->t;
+}
+
+
+double ppg_calib_spo2(double r)
+{
+	const ppg_calib_table_t *t = &s_active->t;
+	int last = t->count - 1;
+
+	if (r <= t->r[0]) return t->spo2[0];
+	if (r >= t->r[last]) return t->spo2[last];
+
+	// r[lo] <= r < r[hi]
+	int lo = 0, hi = last;
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (t->r[mid] <= r) lo = mid;
+		else hi = mid;
+	}
+	double frac = (r - t->r[lo]) / (t->r[hi] - t->r[lo]);
+	return t->spo2[lo] + frac * (t->spo2[hi] - t->spo2[lo]);
+}
+
+
+int32_t ppg_calib_spo2_q16(int32_t r_q16)
+{
+	const calib_slot_t *s = s_active;
+	int last = s->t.count - 1;
+
+	if (r_q16 <= s->r_q16[0]) return s->spo2_q16[0];
+	if (r_q16 >= s->r_q16[last]) return s->spo2_q16[last];
+
+	int lo = 0, hi = last;
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (s->r_q16[mid] <= r_q16) lo = mid;
+		else hi = mid;
+	}
+	int64_t span = s->r_q16[hi] - s->r_q16[lo];
+	if (span == 0) {
+		return s->spo2_q16[lo];   // Points closer than 2^-16 after rounding
+	}
+	int64_t step = (int64_t)(s->spo2_q16[hi] - s->spo2_q16[lo]) * (r_q16 - s->r_q16[lo]);
+	return s->spo2_q16[lo] + (int32_t)(step / span);
+}
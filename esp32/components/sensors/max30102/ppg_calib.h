@@ -0,0 +1,68 @@
+#ifndef PPG_CALIB_H
+#define PPG_CALIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PPG_CALIB_VERSION       1       // Layout of ppg_calib_table_t (NVS blob)
+#define PPG_CALIB_MAX_POINTS    16
+#define PPG_CALIB_LOT_LEN       16
+#define PPG_CALIB_SPO2_MIN      50.0f   // Plausible range of a table point
+#define PPG_CALIB_SPO2_MAX      100.0f
+
+/**
+ * @brief R-ratio -> SpO2 calibration curve of one sensor lot
+ * @details Points sorted by strictly increasing R; SpO2 between two points
+ *          is linearly interpolated and R outside the table is held at the
+ *          end point. The struct is stored as-is in NVS, so any layout
+ *          change must bump PPG_CALIB_VERSION.
+ */
+typedef struct {
+    uint8_t version;                    // PPG_CALIB_VERSION
+    uint8_t count;                      // Points in use, 2..PPG_CALIB_MAX_POINTS
+    char lot[PPG_CALIB_LOT_LEN];        // Sensor lot / hardware batch, NUL terminated
+    float r[PPG_CALIB_MAX_POINTS];      // Ratio of ratios (red AC/DC) / (IR AC/DC)
+    float spo2[PPG_CALIB_MAX_POINTS];   // %
+} ppg_calib_table_t;
+
+/**
+ * @brief Built-in table, the 104 - 17 * R line over 70..100 %
+ * @details Points on the former fixed line, so a device without a lot
+ *          table reads exactly what it did before.
+ */
+void ppg_calib_default(ppg_calib_table_t *t);
+
+/**
+ * @brief Check a table before it is applied or stored
+ * @return false on a wrong version, fewer than 2 points, R not strictly
+ *         increasing or positive, or SpO2 outside PPG_CALIB_SPO2_MIN..MAX
+ */
+bool ppg_calib_validate(const ppg_calib_table_t *t);
+
+/**
+ * @brief Make a table the active curve
+ * @details The table is copied to the inactive one of two slots, its Q16
+ *          mirror is built there, and the active pointer is swapped in a
+ *          single store: the compute task never sees a half-written
+ *          curve. Updates are expected minutes apart, far longer than one
+ *          lookup.
+ * @return false (active curve unchanged) if the table does not validate
+ */
+bool ppg_calib_set(const ppg_calib_table_t *t);
+
+/**
+ * @brief Active table (the default one until ppg_calib_set() succeeds)
+ */
+const ppg_calib_table_t *ppg_calib_get(void);
+
+/**
+ * @brief SpO2 for a ratio of ratios, binary search + linear interpolation
+ */
+double ppg_calib_spo2(double r);
+
+/**
+ * @brief Same lookup in Q16 for the fixed-point build
+ */
+int32_t ppg_calib_spo2_q16(int32_t r_q16);
+
+#endif
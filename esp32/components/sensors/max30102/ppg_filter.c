@@ -0,0 +1,80 @@
+#include <math.h>
+#include <string.h>
+#include "ppg_filter.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/*
+ * Butterworth (Q = 1/sqrt(2)) sections from the RBJ audio EQ cookbook,
+ * normalised by a0. Computed once per sample rate.
+ */
+static void design_biquad(ppg_biquad_t *s, float fc, float fs, bool high_pass)
+{
+	float w0 = 2.0f * (float)M_PI * fc / fs;
+	float cw = cosf(w0);
+	float alpha = sinf(w0) / (2.0f * 0.70710678f);
+	float a0 = 1.0f + alpha;
+
+	if (high_pass) {
+		s->b0 = (1.0f + cw) / 2.0f / a0;
+		s->b1 = -(1.0f + cw) / a0;
+	} else {
+		s->b0 = (1.0f - cw) / 2.0f / a0;
+		s->b1 = (1.0f - cw) / a0;
+	}
+	s->b2 = s->b0;
+	s->a1 = -2.0f * cw / a0;
+	s->a2 = (1.0f - alpha) / a0;
+	s->z1 = 0;
+	s->z2 = 0;
+}
+
+
+static inline float biquad_step(ppg_biquad_t *s, float x)
+{
+	float y = s->b0 * x + s->z1;
+	s->z1 = s->b1 * x - s->a1 * y + s->z2;
+	s->z2 = s->b2 * x - s->a2 * y;
+	return y;
+}
+
+
+void ppg_filter_init(ppg_filter_t *f, float sample_rate)
+{
+	memset(f, 0, sizeof(*f));
+
+	f->dc_alpha = 1.0f - expf(-2.0f * (float)M_PI * PPG_FILTER_DC_HZ / sample_rate);
+	design_biquad(&f->hp, PPG_FILTER_LOW_HZ, sample_rate, true);
+
+	// The low-pass edge must stay below Nyquist at the battery-saving rates
+	float high_hz = PPG_FILTER_HIGH_HZ;
+	if (high_hz > 0.4f * sample_rate) high_hz = 0.4f * sample_rate;
+	design_biquad(&f->lp, high_hz, sample_rate, false);
+
+	f->settle = (uint32_t)(PPG_FILTER_SETTLE_S * sample_rate);
+	f->dc = -1;     // Primed with the first sample
+}
+
+
+bool ppg_filter_process(ppg_filter_t *f, int32_t sample, int32_t *out)
+{
+	float x = (float)sample;
+
+	if (f->dc < 0) {
+		f->dc = x;
+	}
+	f->dc += f->dc_alpha * (x - f->dc);
+
+	float y = biquad_step(&f->hp, x - f->dc);
+	y = biquad_step(&f->lp, y);
+	*out = (int32_t)lroundf(y);
+
+	if (f->settle > 0) {
+		f->settle--;
+		return false;
+	}
+	return true;
+}
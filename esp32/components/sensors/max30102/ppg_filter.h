@@ -0,0 +1,67 @@
+#ifndef PPG_FILTER_H
+#define PPG_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PPG_FILTER_DC_HZ     0.1f   // DC tracker corner (perfusion baseline)
+#define PPG_FILTER_LOW_HZ    0.5f   // Band-pass edges: 30..240 BPM
+#define PPG_FILTER_HIGH_HZ   4.0f
+#define PPG_FILTER_SETTLE_S  2.0f   // Output discarded while the stages settle
+
+/**
+ * @brief Second order section, transposed direct form II
+ */
+typedef struct {
+    float b0, b1, b2;
+    float a1, a2;
+    float z1, z2;
+} ppg_biquad_t;
+
+/**
+ * @brief Streaming PPG filter for one LED channel
+ * @details A one-pole DC tracker removes the ~100k LSB offset before the
+ *          float stages, then a 2nd order Butterworth high-pass at
+ *          PPG_FILTER_LOW_HZ and low-pass at PPG_FILTER_HIGH_HZ remove the
+ *          baseline wander and the noise above the heart rate band. Both
+ *          channels use the same coefficients, so the AC/DC ratio used by
+ *          spo2_measurement() is preserved.
+ */
+typedef struct {
+    float dc;               // Tracked DC level (raw LSB)
+    float dc_alpha;         // EMA factor of the DC tracker
+    ppg_biquad_t hp;
+    ppg_biquad_t lp;
+    uint32_t settle;        // Samples left before the output is valid
+} ppg_filter_t;
+
+/**
+ * @brief Design the filter for a sample rate and reset its state
+ * @param sample_rate Effective PPG rate (algo_ctx.sample_rate)
+ */
+void ppg_filter_init(ppg_filter_t *f, float sample_rate);
+
+/**
+ * @brief Filter one raw FIFO sample
+ * @param out AC component in LSB, band limited to the heart rate band
+ * @return true once the filter has settled and out can be used
+ */
+bool ppg_filter_process(ppg_filter_t *f, int32_t sample, int32_t *out);
+
+/**
+ * @brief Whether the settling period after init is over
+ */
+static inline bool ppg_filter_settled(const ppg_filter_t *f)
+{
+    return f->settle == 0;
+}
+
+/**
+ * @brief Current DC level of the channel (for the SpO2 ratio)
+ */
+static inline uint64_t ppg_filter_dc(const ppg_filter_t *f)
+{
+    return (f->dc > 0) ? (uint64_t)f->dc : 0;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include "ppg_kernels.h"
+
+#if PPG_ESP_DSP
+#include "dsps_dotprod.h"
+#include "dsps_corr.h"
+#endif
+
+
+void ppg_kernel_to_float(const int32_t *in, float *out, int n, float offset)
+{
+	for (int i = 0; i < n; i++) {
+		out[i] = (float)in[i] - offset;
+	}
+}
+
+
+#if PPG_ESP_DSP
+
+float ppg_kernel_dot(const float *a, const float *b, int n)
+{
+	float sum = 0;
+	dsps_dotprod_f32(a, b, &sum, n);
+	return sum;
+}
+
+
+void ppg_kernel_corr(const float *signal, int siglen, const float *pattern, int patlen, float *dest)
+{
+	dsps_corr_f32(signal, siglen, pattern, patlen, dest);
+}
+
+#else
+
+float ppg_kernel_dot(const float *a, const float *b, int n)
+{
+	// Four partial sums: independent FPU chains, and less rounding drift
+	float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		s0 += a[i] * b[i];
+		s1 += a[i + 1] * b[i + 1];
+		s2 += a[i + 2] * b[i + 2];
+		s3 += a[i + 3] * b[i + 3];
+	}
+	for (; i < n; i++) {
+		s0 += a[i] * b[i];
+	}
+	return (s0 + s1) + (s2 + s3);
+}
+
+
+void ppg_kernel_corr(const float *signal, int siglen, const float *pattern, int patlen, float *dest)
+{
+	for (int k = 0; k + patlen <= siglen; k++) {
+		dest[k] = ppg_kernel_dot(&signal[k], pattern, patlen);
+	}
+}
+
+#endif /* PPG_ESP_DSP */
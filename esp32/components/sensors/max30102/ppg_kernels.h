@@ -0,0 +1,38 @@
+#ifndef PPG_KERNELS_H
+#define PPG_KERNELS_H
+
+#include <stdint.h>
+
+/*
+ * Vector kernels behind the correlation routines of algorithm.c.
+ * PPG_ESP_DSP = 1, the default of the ESP-IDF build (components/sensors
+ * CMakeLists), maps them onto esp-dsp, whose dsps_dotprod_f32 /
+ * dsps_corr_f32 resolve to the ae32 or, on the ESP32-S3, the aes3 SIMD
+ * implementation for the target. The host replay (tools/ppg_replay) and
+ * idf.py -DPPG_ESP_DSP=0 build compile the same single-precision loops in
+ * portable C, so they produce the same results.
+ */
+#ifndef PPG_ESP_DSP
+#define PPG_ESP_DSP 0
+#endif
+
+// Scratch buffers passed to the kernels should use this alignment (S3 SIMD loads)
+#define PPG_KERNEL_ALIGN __attribute__((aligned(16)))
+
+/**
+ * @brief out[i] = in[i] - offset, as float
+ */
+void ppg_kernel_to_float(const int32_t *in, float *out, int n, float offset);
+
+/**
+ * @brief Σ a[i] * b[i] for i < n
+ */
+float ppg_kernel_dot(const float *a, const float *b, int n);
+
+/**
+ * @brief Sliding correlation: dest[k] = Σ signal[k + i] * pattern[i], i < patlen
+ * @details k = 0 .. siglen - patlen (siglen - patlen + 1 outputs).
+ */
+void ppg_kernel_corr(const float *signal, int siglen, const float *pattern, int patlen, float *dest);
+
+#endif
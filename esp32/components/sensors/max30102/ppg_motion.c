@@ -0,0 +1,115 @@
+#include <math.h>
+#include <string.h>
+#include "ppg_motion.h"
+
+
+void ppg_motion_ref_push(ppg_motion_ref_t *ref, int64_t t_us, float ax, float ay, float az)
+{
+	ref->t_us[ref->head] = t_us;
+	ref->accel[ref->head][0] = ax;
+	ref->accel[ref->head][1] = ay;
+	ref->accel[ref->head][2] = az;
+	ref->head = (ref->head + 1) % PPG_MOTION_REF_CAPACITY;
+	if (ref->count < PPG_MOTION_REF_CAPACITY) {
+		ref->count++;
+	}
+}
+
+
+bool ppg_motion_ref_at(const ppg_motion_ref_t *ref, int64_t t_us, float accel[PPG_MOTION_AXES])
+{
+	if (ref->count == 0) {
+		return false;
+	}
+
+	// Newest first: PPG bursts only reach a few hundred ms into the past
+	int newer = -1;
+	for (int k = 1; k <= ref->count; k++) {
+		int i = (ref->head + PPG_MOTION_REF_CAPACITY - k) % PPG_MOTION_REF_CAPACITY;
+		if (ref->t_us[i] > t_us) {
+			newer = i;
+			continue;
+		}
+
+		if (newer < 0) {
+			// Past the newest sample: zero-order hold
+			if (t_us - ref->t_us[i] > PPG_MOTION_REF_MAX_AGE_US) {
+				return false;
+			}
+			memcpy(accel, ref->accel[i], sizeof(ref->accel[i]));
+			return true;
+		}
+
+		float f = (float)(t_us - ref->t_us[i]) / (float)(ref->t_us[newer] - ref->t_us[i]);
+		for (int a = 0; a < PPG_MOTION_AXES; a++) {
+			accel[a] = ref->accel[i][a] + f * (ref->accel[newer][a] - ref->accel[i][a]);
+		}
+		return true;
+	}
+	return false;
+}
+
+
+void ppg_motion_init(ppg_motion_t *m, float sample_rate)
+{
+	memset(m, 0, sizeof(*m));
+	for (int a = 0; a < PPG_MOTION_AXES; a++) {
+		ppg_filter_init(&m->ref_filter[a], sample_rate);
+	}
+	m->eps = PPG_MOTION_WEIGHTS * PPG_MOTION_NOISE_LSB * PPG_MOTION_NOISE_LSB;
+}
+
+
+bool ppg_motion_cancel(ppg_motion_t *m, const float *accel, int32_t *red, int32_t *ir)
+{
+	bool live = (accel != NULL);
+
+	if (live) {
+		memcpy(m->last, accel, sizeof(m->last));
+		m->have_last = true;
+	} else if (!m->have_last) {
+		return false;
+	}
+
+	// Shift the delay line and band-pass the new reference sample; the
+	// filters run on every sample so they stay settled across gaps
+	bool settled = true;
+	for (int a = 0; a < PPG_MOTION_AXES; a++) {
+		float *x = &m->x[a * PPG_MOTION_TAPS];
+		m->power -= x[PPG_MOTION_TAPS - 1] * x[PPG_MOTION_TAPS - 1];
+		memmove(&x[1], &x[0], (PPG_MOTION_TAPS - 1) * sizeof(float));
+
+		int32_t filtered;
+		settled &= ppg_filter_process(&m->ref_filter[a],
+		                              (int32_t)lroundf(m->last[a] * PPG_MOTION_LSB_PER_G), &filtered);
+		x[0] = (float)filtered;
+		m->power += x[0] * x[0];
+	}
+	if (m->power < 0) {
+		m->power = 0;   // Rounding drift of the running sum
+	}
+
+	if (!live || !settled) {
+		return false;
+	}
+
+	float y_ir = 0, y_red = 0;
+	for (int k = 0; k < PPG_MOTION_WEIGHTS; k++) {
+		y_ir += m->w_ir[k] * m->x[k];
+		y_red += m->w_red[k] * m->x[k];
+	}
+	float e_ir = (float)*ir - y_ir;
+	float e_red = (float)*red - y_red;
+
+	if (m->power > m->eps) {
+		float g = PPG_MOTION_MU / (m->eps + m->power);
+		for (int k = 0; k < PPG_MOTION_WEIGHTS; k++) {
+			m->w_ir[k] += g * e_ir * m->x[k];
+			m->w_red[k] += g * e_red * m->x[k];
+		}
+	}
+
+	*ir = (int32_t)lroundf(e_ir);
+	*red = (int32_t)lroundf(e_red);
+	return true;
+}
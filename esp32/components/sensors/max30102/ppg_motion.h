@@ -0,0 +1,84 @@
+#ifndef PPG_MOTION_H
+#define PPG_MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppg_filter.h"
+
+#define PPG_MOTION_AXES          3
+#define PPG_MOTION_TAPS          4        // Taps per axis (80 ms of lag at 50 Hz)
+#define PPG_MOTION_MU            0.05f    // NLMS step size (0 < mu < 2)
+#define PPG_MOTION_NOISE_LSB     16.0f    // Accel noise floor after the band-pass (~1 mg)
+#define PPG_MOTION_REF_CAPACITY  64       // Accelerometer samples kept for alignment
+#define PPG_MOTION_REF_MAX_AGE_US 100000  // Hold the newest sample at most this long
+#define PPG_MOTION_LSB_PER_G     16384.0f // Reference scale (MPU6050 at +-2 g)
+
+#define PPG_MOTION_WEIGHTS (PPG_MOTION_AXES * PPG_MOTION_TAPS)
+
+/**
+ * @brief Timestamped accelerometer samples, written by the IMU task
+ * @details The MAX30102 delivers samples in FIFO bursts, up to ~340 ms
+ *          after they were taken, so the reference for each PPG sample is
+ *          looked up by time instead of using the latest reading.
+ */
+typedef struct {
+    int64_t t_us[PPG_MOTION_REF_CAPACITY];
+    float accel[PPG_MOTION_REF_CAPACITY][PPG_MOTION_AXES];     // g
+    uint8_t head;           // Next slot to write
+    uint8_t count;
+} ppg_motion_ref_t;
+
+/**
+ * @brief Adaptive motion-artifact canceller for the red and IR streams
+ * @details Normalised LMS: the accelerometer axes go through the same DC
+ *          tracker and band-pass as the PPG (ppg_filter_t), so gravity and
+ *          posture drop out and only motion inside the heart rate band is
+ *          left. A short FIR per axis and channel models how that motion
+ *          couples into the optical path; its output is subtracted and the
+ *          residual, which keeps the cardiac component the accelerometer
+ *          cannot predict, drives the weight update.
+ *
+ *          Weights only adapt while the reference carries more than
+ *          PPG_MOTION_NOISE_LSB of motion, so a still wrist neither
+ *          disturbs nor forgets them.
+ */
+typedef struct {
+    ppg_filter_t ref_filter[PPG_MOTION_AXES];
+    float last[PPG_MOTION_AXES];            // Held while no reference arrives
+    float x[PPG_MOTION_WEIGHTS];            // Delay line, [axis * TAPS + tap]
+    float w_ir[PPG_MOTION_WEIGHTS];
+    float w_red[PPG_MOTION_WEIGHTS];
+    float power;                            // Sum of x^2
+    float eps;                              // Regulariser and adaptation gate
+    bool have_last;
+} ppg_motion_t;
+
+/**
+ * @brief Append one accelerometer sample
+ * @param t_us Time the sample was taken (esp_timer_get_time())
+ */
+void ppg_motion_ref_push(ppg_motion_ref_t *ref, int64_t t_us, float ax, float ay, float az);
+
+/**
+ * @brief Accelerometer reading at a PPG sample time
+ * @details Linear interpolation between the two samples around t_us; the
+ *          newest one is held for up to PPG_MOTION_REF_MAX_AGE_US.
+ * @return false if the ring does not cover t_us
+ */
+bool ppg_motion_ref_at(const ppg_motion_ref_t *ref, int64_t t_us, float accel[PPG_MOTION_AXES]);
+
+/**
+ * @brief Reset the weights and design the reference filters for a rate
+ */
+void ppg_motion_init(ppg_motion_t *m, float sample_rate);
+
+/**
+ * @brief Remove the motion estimate from one band-passed sample pair
+ * @param accel Reference for this sample (g), NULL if none: the last one
+ *              is held and the samples pass through unchanged
+ * @param red, ir ppg_filter output, replaced by the residual
+ * @return true if a correction was applied
+ */
+bool ppg_motion_cancel(ppg_motion_t *m, const float *accel, int32_t *red, int32_t *ir);
+
+#endif
@@ -0,0 +1,111 @@
+#include <math.h>
+#include <string.h>
+#include "ppg_quality.h"
+#include "algorithm.h"
+
+
+ppg_quality_t ppg_quality_check(int32_t *ir_ac, int32_t *red_ac,
+                                uint64_t ir_dc, uint64_t red_dc,
+                                ppg_quality_metrics_t *metrics)
+{
+	ppg_quality_metrics_t m;
+	memset(&m, 0, sizeof(m));
+	if (metrics) {
+		*metrics = m;
+	}
+
+	if (ir_dc < PPG_QUALITY_DC_MIN) {
+		return PPG_QUALITY_NO_FINGER;
+	}
+	if (ir_dc > PPG_QUALITY_DC_MAX || red_dc > PPG_QUALITY_DC_MAX) {
+		return PPG_QUALITY_SATURATED;
+	}
+
+	int32_t lo = ir_ac[0];
+	int32_t hi = ir_ac[0];
+	for (int i = 1; i < algo_ctx.window_len; i++) {
+		if (ir_ac[i] < lo) lo = ir_ac[i];
+		if (ir_ac[i] > hi) hi = ir_ac[i];
+	}
+
+	m.perfusion_index = 100.0f * (float)(hi - lo) / (float)ir_dc;
+	if (metrics) {
+		*metrics = m;
+	}
+	if (m.perfusion_index < PPG_QUALITY_PI_MIN) {
+		return PPG_QUALITY_LOW_PERFUSION;
+	}
+	if (m.perfusion_index > PPG_QUALITY_PI_MAX) {
+		return PPG_QUALITY_NOISY;
+	}
+
+	m.correlation = (float)correlation_datay_datax(red_ac, ir_ac);
+	if (metrics) {
+		*metrics = m;
+	}
+	if (m.correlation < PPG_QUALITY_CORR_MIN) {
+		return PPG_QUALITY_NOISY;
+	}
+	return PPG_QUALITY_GOOD;
+}
+
+
+float ppg_quality_periodicity(int32_t *ir_ac, int heart_rate)
+{
+	if (heart_rate < HR_MIN_BPM || heart_rate > HR_MAX_BPM) {
+		return 0;
+	}
+
+	int lag = (int)(algo_ctx.bpm_lag_factor / heart_rate + 0.5);
+	double r0 = auto_correlation_function(ir_ac, 0);
+	if (!(r0 > 0) || lag >= algo_ctx.window_len) {
+		return 0;
+	}
+	return (float)(auto_correlation_function(ir_ac, lag) / r0);
+}
+
+
+// 0 at lo, 1 at hi, linear in between
+static float ramp(float x, float lo, float hi)
+{
+	float v = (x - lo) / (hi - lo);
+	return (v < 0) ? 0 : (v > 1) ? 1 : v;
+}
+
+
+uint8_t ppg_quality_confidence(const ppg_quality_metrics_t *metrics,
+                               int heart_rate, int beat_bpm, int beats)
+{
+	if (heart_rate < HR_MIN_BPM || heart_rate > HR_MAX_BPM) {
+		return 0;
+	}
+
+	float period = ramp(metrics->periodicity, PPG_CONF_PERIOD_MIN, PPG_CONF_PERIOD_FULL);
+	float corr = ramp(metrics->correlation, PPG_QUALITY_CORR_MIN, PPG_CONF_CORR_FULL);
+	float pi = (metrics->perfusion_index > 0)
+	         ? ramp(log10f(metrics->perfusion_index), log10f(PPG_QUALITY_PI_MIN), log10f(PPG_CONF_PI_FULL))
+	         : 0;
+
+	// Intervals a window of this length holds at this rate
+	float expected = heart_rate * algo_ctx.window_len * (float)algo_ctx.sample_period / 60.0f;
+	float count = ramp((float)beats, 0, expected - 1);
+
+	// The 333 sentinel of the beat detector scores 0
+	float agree = ramp((float)PPG_CONF_AGREE_BPM - abs(heart_rate - beat_bpm), 0, PPG_CONF_AGREE_BPM);
+
+	float score = 30 * period + 25 * corr + 15 * pi + 15 * count + 15 * agree;
+	return (uint8_t)(score + 0.5f);
+}
+
+
+const char *ppg_quality_name(ppg_quality_t quality)
+{
+	switch (quality) {
+	case PPG_QUALITY_GOOD:          return "good";
+	case PPG_QUALITY_NO_FINGER:     return "no finger";
+	case PPG_QUALITY_SATURATED:     return "saturated";
+	case PPG_QUALITY_LOW_PERFUSION: return "low perfusion";
+	case PPG_QUALITY_NOISY:         return "noisy";
+	}
+	return "?";
+}
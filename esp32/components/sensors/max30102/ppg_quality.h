@@ -0,0 +1,77 @@
+#ifndef PPG_QUALITY_H
+#define PPG_QUALITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PPG_QUALITY_DC_MIN     50000    // IR DC below this at nominal LED current: no finger
+#define PPG_QUALITY_DC_MAX     250000   // ADC full scale is 262143
+#define PPG_QUALITY_PI_MIN     0.05f    // Perfusion index (%) below this: no pulse
+#define PPG_QUALITY_PI_MAX     20.0f    // Above this: motion, not perfusion
+#define PPG_QUALITY_CORR_MIN   0.5      // Red/IR correlation below this: noise
+
+// ppg_quality_confidence(): each term ramps from 0 at the first value to full at the second
+#define PPG_CONF_PI_FULL       1.0f     // Perfusion index (%), log ramp from PPG_QUALITY_PI_MIN
+#define PPG_CONF_CORR_FULL     0.95f    // Red/IR correlation, from PPG_QUALITY_CORR_MIN
+#define PPG_CONF_PERIOD_MIN    0.3f     // R(lag)/R(0) at the HR lag (calculate_heart_rate() needs > 0.3)
+#define PPG_CONF_PERIOD_FULL   0.8f
+#define PPG_CONF_AGREE_BPM     15       // Window HR vs. beat-interval HR: 0 points at this difference
+
+typedef enum {
+    PPG_QUALITY_GOOD = 0,
+    PPG_QUALITY_NO_FINGER,          // DC too low
+    PPG_QUALITY_SATURATED,          // DC at the top of the ADC range
+    PPG_QUALITY_LOW_PERFUSION,      // Finger present, no usable pulse
+    PPG_QUALITY_NOISY,              // Channels do not pulse together
+} ppg_quality_t;
+
+/**
+ * @brief Signal measures behind a reading
+ */
+typedef struct {
+    float perfusion_index;  // IR AC peak-to-peak / DC (%)
+    float correlation;      // Red/IR correlation (0 if the check stopped before it)
+    float periodicity;      // R(lag)/R(0) at the reported HR, from ppg_quality_periodicity()
+} ppg_quality_metrics_t;
+
+/**
+ * @brief Grade one detrended window before the HR/SpO2 estimators run
+ * @details Cheapest test first: DC level (O(1)), then the IR perfusion
+ *          index (one min/max pass), then the red/IR correlation from
+ *          correlation_datay_datax(). Both LEDs see the same arterial
+ *          pulse, so a low correlation means motion or ambient light.
+ * @param ir_ac, red_ac  Window with DC and trend removed
+ * @param ir_dc, red_dc  DC levels of the window
+ * @param metrics Output, perfusion index and correlation as far as the
+ *                checks got (may be NULL); periodicity is left at 0
+ * @return PPG_QUALITY_GOOD if the estimators should run
+ */
+ppg_quality_t ppg_quality_check(int32_t *ir_ac, int32_t *red_ac,
+                                uint64_t ir_dc, uint64_t red_dc,
+                                ppg_quality_metrics_t *metrics);
+
+/**
+ * @brief Normalized autocorrelation of the IR window at the lag of a heart rate
+ * @details Same biased R(k)/R(0) that calculate_heart_rate() compares with
+ *          its 0.3 threshold, so it can be computed for any estimator:
+ *          two O(N) passes.
+ * @return 0 for the 333 sentinel or a rate outside HR_MIN_BPM..HR_MAX_BPM
+ */
+float ppg_quality_periodicity(int32_t *ir_ac, int heart_rate);
+
+/**
+ * @brief 0-100 confidence of a reading that passed ppg_quality_check()
+ * @details Weighted sum of five terms, each clamped to 0..1: periodicity
+ *          (30), red/IR correlation (25), perfusion index (15), accepted
+ *          beats against those expected in the window at heart_rate (15)
+ *          and agreement of heart_rate with the beat-interval rate (15).
+ *          A window the estimator found no peak in scores 0.
+ * @param beat_bpm ppg_beat_heart_rate() over the window span
+ * @param beats    ppg_beat_count() over the window span
+ */
+uint8_t ppg_quality_confidence(const ppg_quality_metrics_t *metrics,
+                               int heart_rate, int beat_bpm, int beats);
+
+const char *ppg_quality_name(ppg_quality_t quality);
+
+#endif
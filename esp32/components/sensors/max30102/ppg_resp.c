@@ -0,0 +1,211 @@
+#include <math.h>
+#include <string.h>
+#include "ppg_resp.h"
+#include "ppg_kernels.h"
+
+#define MIN_CORR        0.3f    // Autocorrelation a series needs to count as periodic
+#define FUNDAMENTAL     0.8f    // First peak within this * best peak wins (not a multiple)
+#define LAG_MIN         (60 * PPG_RESP_RATE_HZ / PPG_RESP_MAX_BRPM)
+#define LAG_MAX         ((60 * PPG_RESP_RATE_HZ + PPG_RESP_MIN_BRPM - 1) / PPG_RESP_MIN_BRPM)
+
+// Scratch of ppg_resp_estimate(): one series at a time
+static float s_work[PPG_RESP_CAPACITY] PPG_KERNEL_ALIGN;
+static float s_acf[LAG_MAX + 2];
+
+
+void ppg_resp_init(ppg_resp_t *r, float sample_rate)
+{
+	memset(r, 0, sizeof(*r));
+	r->ms_per_sample = 1000.0f / sample_rate;
+	r->grid_step = sample_rate / PPG_RESP_RATE_HZ;
+}
+
+
+void ppg_resp_sample(ppg_resp_t *r, int32_t raw_ir)
+{
+	r->cycle_sum += raw_ir;
+	r->cycle_count++;
+	r->n++;
+}
+
+
+static void push_grid(ppg_resp_t *r, const float *v)
+{
+	for (int s = 0; s < PPG_RESP_SERIES; s++) {
+		r->ring[s][r->head] = v[s];
+	}
+	r->head = (r->head + 1) % PPG_RESP_CAPACITY;
+	if (r->count < PPG_RESP_CAPACITY) {
+		r->count++;
+	}
+}
+
+
+void ppg_resp_beat(ppg_resp_t *r, const ppg_beat_t *b, bool accepted)
+{
+	float t = (float)b->last_n + b->last_frac;
+	float v[PPG_RESP_SERIES];
+
+	v[PPG_RESP_BW] = (r->cycle_count > 0) ? (float)r->cycle_sum / r->cycle_count : r->prev[PPG_RESP_BW];
+	v[PPG_RESP_AM] = b->cand_amp;
+	v[PPG_RESP_FM] = accepted ? (float)b->rr[(b->head + PPG_BEAT_RR_CAPACITY - 1) % PPG_BEAT_RR_CAPACITY]
+	                          : r->prev[PPG_RESP_FM];
+	r->cycle_sum = 0;
+	r->cycle_count = 0;
+
+	// A long hole cannot be bridged by interpolation: start the series over
+	if (r->have_prev && (t - r->prev_t) * r->ms_per_sample > PPG_RESP_MAX_GAP_S * 1000) {
+		r->have_prev = false;
+		r->head = 0;
+		r->count = 0;
+	}
+
+	if (!r->have_prev) {
+		r->have_prev = true;
+		r->next_t = t;
+	} else {
+		// The first interval is only known at the second beat
+		if (r->prev[PPG_RESP_FM] <= 0) r->prev[PPG_RESP_FM] = v[PPG_RESP_FM];
+		if (v[PPG_RESP_FM] <= 0) v[PPG_RESP_FM] = r->prev[PPG_RESP_FM];
+
+		float span = t - r->prev_t;
+		while (span > 0 && r->next_t <= t) {
+			float frac = (r->next_t - r->prev_t) / span;
+			float g[PPG_RESP_SERIES];
+			for (int s = 0; s < PPG_RESP_SERIES; s++) {
+				g[s] = r->prev[s] + frac * (v[s] - r->prev[s]);
+			}
+			push_grid(r, g);
+			r->next_t += r->grid_step;
+		}
+	}
+
+	r->prev_t = t;
+	memcpy(r->prev, v, sizeof(r->prev));
+}
+
+
+void ppg_resp_rescale(ppg_resp_t *r, float gain)
+{
+	static const int scaled[] = {PPG_RESP_BW, PPG_RESP_AM};
+
+	for (size_t k = 0; k < sizeof(scaled) / sizeof(scaled[0]); k++) {
+		int s = scaled[k];
+		for (int i = 0; i < PPG_RESP_CAPACITY; i++) {
+			r->ring[s][i] *= gain;
+		}
+		r->prev[s] *= gain;
+	}
+	r->cycle_sum = 0;
+	r->cycle_count = 0;
+}
+
+
+/*
+ * Rate of one series: linear detrend, unbiased autocorrelation over the
+ * breathing lags, first peak close to the best one, parabolic refinement.
+ */
+static float series_rate(const ppg_resp_t *r, int series, int n)
+{
+	int start = (r->head + PPG_RESP_CAPACITY - n) % PPG_RESP_CAPACITY;
+	float ref = r->ring[series][start];     // Keeps the float sums small (BW is ~1e5 LSB)
+	float sum = 0, isum = 0;
+
+	for (int i = 0; i < n; i++) {
+		float y = r->ring[series][(start + i) % PPG_RESP_CAPACITY] - ref;
+		s_work[i] = y;
+		sum += y;
+		isum += i * y;
+	}
+
+	// Least squares line over i = 0..n-1
+	float mean_i = (n - 1) / 2.0f;
+	float sxx = (float)n * ((float)n * n - 1) / 12.0f;
+	float slope = (isum - mean_i * sum) / sxx;
+	float mean = sum / n;
+	for (int i = 0; i < n; i++) {
+		s_work[i] -= mean + slope * (i - mean_i);
+	}
+
+	float r0 = ppg_kernel_dot(s_work, s_work, n) / n;
+	if (!(r0 > 0)) {
+		return 0;
+	}
+	for (int k = LAG_MIN - 1; k <= LAG_MAX + 1; k++) {
+		s_acf[k] = ppg_kernel_dot(s_work, &s_work[k], n - k) / (n - k) / r0;
+	}
+
+	float best = 0;
+	for (int k = LAG_MIN; k <= LAG_MAX; k++) {
+		if (s_acf[k] > s_acf[k - 1] && s_acf[k] >= s_acf[k + 1] && s_acf[k] > best) {
+			best = s_acf[k];
+		}
+	}
+	if (best < MIN_CORR) {
+		return 0;
+	}
+
+	for (int k = LAG_MIN; k <= LAG_MAX; k++) {
+		if (s_acf[k] > s_acf[k - 1] && s_acf[k] >= s_acf[k + 1] && s_acf[k] >= FUNDAMENTAL * best) {
+			float denom = s_acf[k - 1] - 2 * s_acf[k] + s_acf[k + 1];
+			float delta = (denom != 0) ? 0.5f * (s_acf[k - 1] - s_acf[k + 1]) / denom : 0;
+			return 60.0f * PPG_RESP_RATE_HZ / (k + delta);
+		}
+	}
+	return 0;
+}
+
+
+bool ppg_resp_estimate(const ppg_resp_t *r, ppg_resp_result_t *result)
+{
+	int n = r->count;
+	if (n > PPG_RESP_SPAN_S * PPG_RESP_RATE_HZ) {
+		n = PPG_RESP_SPAN_S * PPG_RESP_RATE_HZ;
+	}
+
+	memset(result, 0, sizeof(*result));
+	result->span_s = (uint16_t)(n / PPG_RESP_RATE_HZ);
+	if (n < PPG_RESP_MIN_S * PPG_RESP_RATE_HZ) {
+		return false;
+	}
+
+	// Periodic series, sorted by rate
+	float rates[PPG_RESP_SERIES];
+	int which[PPG_RESP_SERIES];
+	int valid = 0;
+	for (int s = 0; s < PPG_RESP_SERIES; s++) {
+		float rate = series_rate(r, s, n);
+		result->series_brpm[s] = rate;
+		if (rate > 0) {
+			int i = valid++;
+			while (i > 0 && rates[i - 1] > rate) {
+				rates[i] = rates[i - 1];
+				which[i] = which[i - 1];
+				i--;
+			}
+			rates[i] = rate;
+			which[i] = s;
+		}
+	}
+	if (valid < 2) {
+		return false;
+	}
+
+	// All agree, or drop the odd one out of three
+	int first = 0, last = valid - 1;
+	if (rates[last] - rates[first] > PPG_RESP_MAX_SPREAD && valid == 3) {
+		if (rates[1] - rates[0] <= rates[2] - rates[1]) last = 1;
+		else first = 1;
+	}
+	if (rates[last] - rates[first] > PPG_RESP_MAX_SPREAD) {
+		return false;
+	}
+
+	float sum = 0;
+	for (int i = first; i <= last; i++) {
+		sum += rates[i];
+		result->used |= 1u << which[i];
+	}
+	result->rate_brpm = sum / (last - first + 1);
+	return true;
+}
@@ -0,0 +1,102 @@
+#ifndef PPG_RESP_H
+#define PPG_RESP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppg_beat.h"
+
+#define PPG_RESP_RATE_HZ    4       // Uniform rate of the respiratory series
+#define PPG_RESP_CAPACITY   256     // 64 s at PPG_RESP_RATE_HZ
+#define PPG_RESP_SPAN_S     60      // Longest span an estimate looks at
+#define PPG_RESP_MIN_S      30      // Shortest span that gives an estimate
+#define PPG_RESP_MIN_BRPM   6       // Search band (breaths per minute)
+#define PPG_RESP_MAX_BRPM   40
+#define PPG_RESP_MAX_GAP_S  4       // Longer without a beat restarts the series
+#define PPG_RESP_MAX_SPREAD 4.0f    // Fused series must agree within this (breaths per minute)
+
+/**
+ * @brief Respiratory modulations of the PPG, one series each
+ */
+typedef enum {
+    PPG_RESP_BW = 0,        // Baseline wander: mean IR intensity of each cardiac cycle
+    PPG_RESP_AM,            // Amplitude modulation: trough-to-peak amplitude of each beat
+    PPG_RESP_FM,            // Frequency modulation: interval to the previous beat (RSA)
+    PPG_RESP_SERIES
+} ppg_resp_series_t;
+
+/**
+ * @brief Respiratory rate and the per-modulation estimates behind it
+ */
+typedef struct {
+    float rate_brpm;                    // Fused rate (0 = not available)
+    float series_brpm[PPG_RESP_SERIES]; // 0 where the series had no clear period
+    uint8_t used;                       // Bit per ppg_resp_series_t in the fused rate
+    uint16_t span_s;                    // Seconds of data behind the estimate
+} ppg_resp_result_t;
+
+/**
+ * @brief Respiratory rate from baseline, amplitude and frequency modulation
+ * @details Everything per sample and per beat is O(1): the raw IR is summed
+ *          over the current cardiac cycle, and each confirmed beat adds one
+ *          BW/AM/FM value that is linearly interpolated onto a
+ *          PPG_RESP_RATE_HZ grid in a ring of up to 64 s. The estimate
+ *          itself (ppg_resp_estimate()) is meant to run every few seconds:
+ *          each series is detrended, its autocorrelation searched over
+ *          PPG_RESP_MIN_BRPM..MAX_BRPM, and the three rates are fused only
+ *          if at least two have a clear period and agree within
+ *          PPG_RESP_MAX_SPREAD (the modulations fail differently, so
+ *          agreement is the quality test).
+ */
+typedef struct {
+    float ms_per_sample;
+    uint32_t n;                 // Samples fed
+    int64_t cycle_sum;          // Raw IR over the current cardiac cycle
+    uint32_t cycle_count;
+
+    bool have_prev;             // Previous beat for the interpolation
+    float prev_t;               // Its time (samples)
+    float prev[PPG_RESP_SERIES];
+    float next_t;               // Next grid time (samples)
+    float grid_step;            // Samples per grid point
+
+    float ring[PPG_RESP_SERIES][PPG_RESP_CAPACITY];
+    uint16_t head;              // Next slot to write
+    uint16_t count;
+} ppg_resp_t;
+
+/**
+ * @brief Reset for a sample rate (at stream start)
+ */
+void ppg_resp_init(ppg_resp_t *r, float sample_rate);
+
+/**
+ * @brief Feed one raw (unfiltered) IR sample, in step with ppg_beat_process()
+ */
+void ppg_resp_sample(ppg_resp_t *r, int32_t raw_ir);
+
+/**
+ * @brief Close the cardiac cycle at a beat just confirmed by ppg_beat_process()
+ * @param b The beat detector, read for the beat time, amplitude and interval
+ * @param accepted Return value of ppg_beat_process(): false when the interval
+ *                 was out of range (the last accepted one is held for FM)
+ */
+void ppg_resp_beat(ppg_resp_t *r, const ppg_beat_t *b, bool accepted);
+
+/**
+ * @brief Carry the series across a change of the input gain
+ * @param gain New counts / old counts (ppg_agc_gain_ratio())
+ * @details BW and AM are proportional to the gain, and a linear detrend
+ *          cannot remove a step of the whole DC, so their history is
+ *          rescaled to the new gain. The open cardiac cycle mixes both
+ *          gains and is dropped. FM (intervals) does not depend on it.
+ */
+void ppg_resp_rescale(ppg_resp_t *r, float gain);
+
+/**
+ * @brief Estimate the respiratory rate over the last PPG_RESP_SPAN_S
+ * @return false (result->rate_brpm = 0) with less than PPG_RESP_MIN_S of
+ *         data or when the modulations disagree
+ */
+bool ppg_resp_estimate(const ppg_resp_t *r, ppg_resp_result_t *result);
+
+#endif
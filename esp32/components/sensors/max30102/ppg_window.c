@@ -0,0 +1,99 @@
+#include "ppg_window.h"
+#include <string.h>
+
+// Time axis in samples: Σi and Σi² over 0..N-1 come from algo_ctx
+#define SUM_X   algo_ctx.sum_i
+#define SUM_X2  algo_ctx.sum_i2
+
+
+void ppg_window_init(ppg_window_t *w, uint16_t hop)
+{
+	memset(w, 0, sizeof(*w));
+	w->len = (uint16_t)algo_ctx.window_len;
+	if (hop == 0) hop = 1;
+	if (hop > w->len) hop = w->len;
+	w->hop = hop;
+}
+
+
+/*
+ * Shifting the window by one sample renumbers every index down by one:
+ *   Σ i*y  ->  Σ i*y - (Σ y - y_oldest) + (N-1) * y_new
+ */
+static inline void slide(int64_t *sum, int64_t *isum, int32_t oldest, int32_t value,
+                         uint16_t count, uint16_t len)
+{
+	if (count < len) {
+		*isum += (int64_t)count * value;
+		*sum += value;
+		return;
+	}
+	*isum += -(*sum - oldest) + (int64_t)(len - 1) * value;
+	*sum += value - oldest;
+}
+
+
+bool ppg_window_push(ppg_window_t *w, int32_t red, int32_t ir)
+{
+	uint16_t slot = (w->count < w->len) ? w->count : w->head;
+
+	slide(&w->ir_sum, &w->ir_isum, w->ir[slot], ir, w->count, w->len);
+	slide(&w->red_sum, &w->red_isum, w->red[slot], red, w->count, w->len);
+
+	w->ir[slot] = ir;
+	w->red[slot] = red;
+
+	if (w->count < w->len) {
+		w->count++;
+	} else {
+		w->head = (w->head + 1) % w->len;
+	}
+
+	if (w->since_last < w->hop) {
+		w->since_last++;
+	}
+	return (w->count == w->len) && (w->since_last >= w->hop);
+}
+
+
+/*
+ * Least squares fit y = a*i + b from the running sums, then one pass that
+ * unrolls the ring and subtracts the fitted line (which also carries the DC).
+ */
+static void detrend(const int32_t *ring, uint16_t len, uint16_t head, int64_t sum, int64_t isum,
+                    int32_t *out)
+{
+	const double n = len;
+	double a = ((n * isum) - ((double)SUM_X * sum)) / ((n * SUM_X2) - ((double)SUM_X * SUM_X));
+	double line = (sum - (a * SUM_X)) / n;
+
+	for (int i = 0; i < len; i++) {
+		out[i] = (int32_t)(ring[(head + i) % len] - line);
+		line += a;
+	}
+}
+
+
+void ppg_window_snapshot(ppg_window_t *w, int32_t *ir_out, int32_t *red_out,
+                         uint64_t *ir_mean, uint64_t *red_mean)
+{
+	*ir_mean = (uint64_t)(w->ir_sum / w->len);
+	*red_mean = (uint64_t)(w->red_sum / w->len);
+
+	detrend(w->ir, w->len, w->head, w->ir_sum, w->ir_isum, ir_out);
+	detrend(w->red, w->len, w->head, w->red_sum, w->red_isum, red_out);
+
+	w->since_last = 0;
+}
+
+
+void ppg_window_copy(ppg_window_t *w, int32_t *ir_out, int32_t *red_out)
+{
+	for (int i = 0; i < w->len; i++) {
+		uint16_t slot = (w->head + i) % w->len;
+		ir_out[i] = w->ir[slot];
+		red_out[i] = w->red[slot];
+	}
+
+	w->since_last = 0;
+}
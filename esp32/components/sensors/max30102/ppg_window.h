@@ -0,0 +1,67 @@
+#ifndef PPG_WINDOW_H
+#define PPG_WINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+
+/**
+ * @brief Sliding PPG window over the last algo_ctx.window_len red/IR samples
+ * @details Samples are kept in a ring buffer together with running sums
+ *          of y and i*y (i = 0 for the oldest sample), so the DC mean and
+ *          the linear trend of the window are available in O(1) after
+ *          every new sample instead of being recomputed over the buffer.
+ */
+typedef struct {
+    int32_t ir[BUFFER_SIZE];
+    int32_t red[BUFFER_SIZE];
+    uint16_t len;           // Window length, algo_ctx.window_len at init
+    uint16_t head;          // Index of the oldest sample (next to overwrite)
+    uint16_t count;         // Valid samples in the ring
+    uint16_t hop;           // New samples between two estimates
+    uint16_t since_last;    // New samples since the last snapshot
+    int64_t ir_sum;         // Σ ir[i]
+    int64_t red_sum;        // Σ red[i]
+    int64_t ir_isum;        // Σ i * ir[i]
+    int64_t red_isum;       // Σ i * red[i]
+} ppg_window_t;
+
+/**
+ * @brief Reset the window to the current algo_ctx.window_len
+ * @param hop Number of new samples between estimates (1..window length)
+ * @note Call after algorithm_init()
+ */
+void ppg_window_init(ppg_window_t *w, uint16_t hop);
+
+/**
+ * @brief Append one sample, dropping the oldest once the window is full
+ * @return true when the window is full and an estimate is due
+ */
+bool ppg_window_push(ppg_window_t *w, int32_t red, int32_t ir);
+
+/**
+ * @brief Copy the window out in time order with DC and linear trend removed
+ * @details Equivalent to remove_dc_part() followed by remove_trend_line()
+ *          on both channels, but the regression comes from the running sums.
+ *          Resets the hop counter.
+ */
+void ppg_window_snapshot(ppg_window_t *w, int32_t *ir_out, int32_t *red_out,
+                         uint64_t *ir_mean, uint64_t *red_mean);
+
+/**
+ * @brief Copy the window out in time order without any processing
+ * @details For samples that were already filtered on arrival (ppg_filter).
+ *          Resets the hop counter.
+ */
+void ppg_window_copy(ppg_window_t *w, int32_t *ir_out, int32_t *red_out);
+
+/**
+ * @brief DC mean of both channels from the running sums, without a copy
+ */
+static inline void ppg_window_mean(const ppg_window_t *w, uint64_t *ir_mean, uint64_t *red_mean)
+{
+    *ir_mean = (w->count > 0) ? (uint64_t)(w->ir_sum / w->count) : 0;
+    *red_mean = (w->count > 0) ? (uint64_t)(w->red_sum / w->count) : 0;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include "imu_fusion.h"
+
+#include <math.h>
+#include <string.h>
+
+#define DEG2RAD ((float)M_PI / 180.0f)
+#define RAD2DEG (180.0f / (float)M_PI)
+
+// 1/sqrt(x): ước lượng bit rồi hai bước Newton (sai số ~5e-6). Một bước
+// (0.17 %) không đủ: chuẩn hoá mỗi mẫu sẽ giữ |q| lệch 1 đúng bằng sai số
+// đó và góc nghiêng tính ra lệch vài độ.
+static float inv_sqrt(float x)
+{
+    float half = 0.5f * x;
+    uint32_t i;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f3759df - (i >> 1);
+    memcpy(&x, &i, sizeof(x));
+    x *= 1.5f - half * x * x;
+    return x * (1.5f - half * x * x);
+}
+
+// Quaternion từ gia tốc (yaw = 0), cho mẫu đầu và sau khoảng trống
+static void reset_from_accel(imu_fusion_t *f, float ax, float ay, float az)
+{
+    float roll = atan2f(ay, az);
+    float pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
+    float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+    float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+
+    f->q0 = cr * cp;
+    f->q1 = sr * cp;
+    f->q2 = cr * sp;
+    f->q3 = -sr * sp;
+    f->ix = f->iy = f->iz = 0.0f;
+}
+
+void imu_fusion_init(imu_fusion_t *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->q0 = 1.0f;
+}
+
+void imu_fusion_update(imu_fusion_t *f, int64_t t_us,
+                       float gx, float gy, float gz,
+                       float ax, float ay, float az)
+{
+    float dt = (float)(t_us - f->last_us) * 1e-6f;
+    float a2 = ax * ax + ay * ay + az * az;
+    bool first = (f->last_us == 0);
+    f->last_us = t_us;
+
+    if (first || dt <= 0.0f || dt > IMU_FUSION_MAX_DT_S)
+    {
+        if (a2 > 0.0f)
+        {
+            reset_from_accel(f, ax, ay, az);
+        }
+        return;
+    }
+
+    gx *= DEG2RAD;
+    gy *= DEG2RAD;
+    gz *= DEG2RAD;
+
+    // Lúc rơi / va chạm gia tốc kế không chỉ trọng lực: chỉ tích phân gyro
+    if (a2 > IMU_FUSION_ACC_MIN_G * IMU_FUSION_ACC_MIN_G &&
+        a2 < IMU_FUSION_ACC_MAX_G * IMU_FUSION_ACC_MAX_G)
+    {
+        float r = inv_sqrt(a2);
+        ax *= r;
+        ay *= r;
+        az *= r;
+
+        // Nửa vector trọng lực suy ra từ quaternion
+        float vx = f->q1 * f->q3 - f->q0 * f->q2;
+        float vy = f->q0 * f->q1 + f->q2 * f->q3;
+        float vz = f->q0 * f->q0 - 0.5f + f->q3 * f->q3;
+
+        // Sai lệch = đo được x suy ra
+        float ex = ay * vz - az * vy;
+        float ey = az * vx - ax * vz;
+        float ez = ax * vy - ay * vx;
+
+        if (IMU_FUSION_KI > 0.0f)
+        {
+            f->ix += 2.0f * IMU_FUSION_KI * ex * dt;
+            f->iy += 2.0f * IMU_FUSION_KI * ey * dt;
+            f->iz += 2.0f * IMU_FUSION_KI * ez * dt;
+            gx += f->ix;
+            gy += f->iy;
+            gz += f->iz;
+        }
+        gx += 2.0f * IMU_FUSION_KP * ex;
+        gy += 2.0f * IMU_FUSION_KP * ey;
+        gz += 2.0f * IMU_FUSION_KP * ez;
+    }
+
+    // q' = q + 0.5 * q * (0, g) * dt
+    gx *= 0.5f * dt;
+    gy *= 0.5f * dt;
+    gz *= 0.5f * dt;
+    float qa = f->q0, qb = f->q1, qc = f->q2;
+    f->q0 += -qb * gx - qc * gy - f->q3 * gz;
+    f->q1 += qa * gx + qc * gz - f->q3 * gy;
+    f->q2 += qa * gy - qb * gz + f->q3 * gx;
+    f->q3 += qa * gz + qb * gy - qc * gx;
+
+    float r = inv_sqrt(f->q0 * f->q0 + f->q1 * f->q1 + f->q2 * f->q2 + f->q3 * f->q3);
+    f->q0 *= r;
+    f->q1 *= r;
+    f->q2 *= r;
+    f->q3 *= r;
+}
+
+void imu_fusion_angles(const imu_fusion_t *f, float *roll, float *pitch)
+{
+    float s = 2.0f * (f->q0 * f->q2 - f->q3 * f->q1);
+    s = (s > 1.0f) ? 1.0f : (s < -1.0f) ? -1.0f : s;
+
+    *roll = atan2f(2.0f * (f->q0 * f->q1 + f->q2 * f->q3),
+                   1.0f - 2.0f * (f->q1 * f->q1 + f->q2 * f->q2)) * RAD2DEG;
+    *pitch = asinf(s) * RAD2DEG;
+}
+
+void imu_fusion_vertical(const imu_fusion_t *f, float v[3])
+{
+    v[0] = 2.0f * (f->q1 * f->q3 - f->q0 * f->q2);
+    v[1] = 2.0f * (f->q0 * f->q1 + f->q2 * f->q3);
+    v[2] = f->q0 * f->q0 - f->q1 * f->q1 - f->q2 * f->q2 + f->q3 * f->q3;
+}
+
+float imu_fusion_tilt(const imu_fusion_t *f, int axis)
+{
+    float v[3];
+    imu_fusion_vertical(f, v);
+
+    float c = fabsf(v[(axis >= 0 && axis < 3) ? axis : 2]);
+    return acosf(c > 1.0f ? 1.0f : c) * RAD2DEG;
+}
+
+imu_posture_t imu_fusion_posture(const imu_fusion_t *f, int axis, float lying_deg)
+{
+    return (imu_fusion_tilt(f, axis) > lying_deg) ? IMU_POSTURE_LYING : IMU_POSTURE_UPRIGHT;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define IMU_FUSION_KP 0.5f          // Hệ số tỉ lệ kéo về hướng trọng lực
+#define IMU_FUSION_KI 0.0f          // Hệ số tích phân (bù lệch gyro), 0 = tắt
+#define IMU_FUSION_ACC_MIN_G 0.8f   // Chỉ tin gia tốc kế khi |a| gần 1 g:
+#define IMU_FUSION_ACC_MAX_G 1.2f   // lúc rơi / va chạm chỉ tích phân gyro
+#define IMU_FUSION_MAX_DT_S 0.1f    // Khoảng trống dài hơn: khởi tạo lại từ gia tốc
+
+    typedef enum
+    {
+        IMU_POSTURE_UPRIGHT = 0,
+        IMU_POSTURE_LYING,
+    } imu_posture_t;
+
+    /**
+     * @brief Bộ lọc Mahony: quaternion hướng từ gyro + gia tốc
+     * @details Gyro được tích phân mỗi mẫu; sai lệch giữa trọng lực đo được
+     *          và trọng lực suy ra từ quaternion (tích có hướng) kéo hướng về
+     *          lại với hệ số IMU_FUSION_KP. Chỉ dùng float và 1/sqrt nhanh,
+     *          khoảng 60 phép nhân mỗi mẫu, không có hàm lượng giác; góc chỉ
+     *          tính khi cần (imu_fusion_angles(), imu_fusion_tilt()).
+     */
+    typedef struct
+    {
+        float q0, q1, q2, q3;       // Quaternion cảm biến -> thế giới
+        float ix, iy, iz;           // Tích phân sai lệch (rad/s)
+        int64_t last_us;            // Thời điểm mẫu trước (0 = chưa có)
+    } imu_fusion_t;
+
+    /**
+     * @brief Xoá trạng thái; mẫu đầu tiên sẽ đặt hướng từ gia tốc
+     */
+    void imu_fusion_init(imu_fusion_t *f);
+
+    /**
+     * @brief Cập nhật với một mẫu
+     * @param t_us       Thời điểm lấy mẫu (mpu6050_data_t.t_us)
+     * @param gx, gy, gz Tốc độ góc (°/s)
+     * @param ax, ay, az Gia tốc (g)
+     */
+    void imu_fusion_update(imu_fusion_t *f, int64_t t_us,
+                           float gx, float gy, float gz,
+                           float ax, float ay, float az);
+
+    /**
+     * @brief Roll / pitch (độ) từ quaternion
+     */
+    void imu_fusion_angles(const imu_fusion_t *f, float *roll, float *pitch);
+
+    /**
+     * @brief Phương thẳng đứng (hướng lên) trong hệ cảm biến, vector đơn vị
+     */
+    void imu_fusion_vertical(const imu_fusion_t *f, float v[3]);
+
+    /**
+     * @brief Góc giữa một trục cảm biến và phương thẳng đứng (0..90°, bỏ qua dấu)
+     * @param axis 0 = X, 1 = Y, 2 = Z
+     */
+    float imu_fusion_tilt(const imu_fusion_t *f, int axis);
+
+    /**
+     * @brief Nằm / đứng theo trục hướng lên khi người đeo đứng thẳng
+     * @param axis      Trục đó (0 = X, 1 = Y, 2 = Z)
+     * @param lying_deg Nghiêng quá góc này là nằm
+     */
+    imu_posture_t imu_fusion_posture(const imu_fusion_t *f, int axis, float lying_deg);
+
+#ifdef __cplusplus
+}
+#endif
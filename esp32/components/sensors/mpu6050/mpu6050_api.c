@@ -2,7 +2,11 @@
 
 #include <math.h>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
 #include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
 
 static const char *TAG = "APP_MPU6050";
 
@@ -13,13 +17,37 @@ static const char *TAG = "APP_MPU6050";
 #define MPU6050_REG_CONFIG 0x1A
 #define MPU6050_REG_GYRO_CONFIG 0x1B
 #define MPU6050_REG_ACCEL_CONFIG 0x1C
+#define MPU6050_REG_MOT_THR 0x1F
+#define MPU6050_REG_MOT_DUR 0x20
+#define MPU6050_REG_FIFO_EN 0x23
+#define MPU6050_REG_INT_PIN_CFG 0x37
+#define MPU6050_REG_INT_ENABLE 0x38
+#define MPU6050_REG_INT_STATUS 0x3A
+#define MPU6050_REG_USER_CTRL 0x6A
+#define MPU6050_REG_FIFO_COUNT_H 0x72
+#define MPU6050_REG_FIFO_R_W 0x74
 #define MPU6050_REG_PWR_MGMT_1 0x6B
 #define MPU6050_REG_WHO_AM_I 0x75
 
 #define MPU6050_REG_ACCEL_XOUT_H 0x3B
 
+// FIFO_EN: TEMP | XG | YG | ZG | ACCEL
+#define MPU6050_FIFO_EN_ALL 0xF8
+// USER_CTRL
+#define MPU6050_USER_FIFO_EN 0x40
+#define MPU6050_USER_FIFO_RESET 0x04
+// INT_PIN_CFG: mức cao, push-pull, LATCH_INT_EN; chỉ đọc INT_STATUS mới xoá
+#define MPU6050_INT_PIN_LATCH 0x20
+// ACCEL_CONFIG: ±2g, ACCEL_HPF = 5 Hz (chỉ cho bộ phát hiện, không ảnh hưởng dữ liệu).
+// DHPF cũng đưa vào bộ phát hiện rơi tự do: khi nằm yên cả ba trục ~0 g nên
+// FF_INT bật liên tục, vì vậy chỉ dùng MOT_INT.
+#define MPU6050_ACCEL_2G_HPF_5HZ 0x01
+#define MPU6050_MG_PER_LSB 2.0f
+
 static i2c_port_t s_port = I2C_NUM_MAX;
 static bool s_ready = false;
+static gpio_num_t s_int_pin = GPIO_NUM_NC;
+static TaskHandle_t s_int_task = NULL;
 
 static esp_err_t mpu_write_reg(uint8_t reg, uint8_t val)
 {
@@ -80,7 +108,7 @@ esp_err_t mpu6050_init(i2c_port_t port)
 
     // Set sample rate = 1kHz / (1 + SMPLRT_DIV)
     // Ví dụ chọn 100 Hz => div = 9
-    err = mpu_write_reg(MPU6050_REG_SMPLRT_DIV, 9);
+    err = mpu_write_reg(MPU6050_REG_SMPLRT_DIV, 1000 / MPU6050_SAMPLE_RATE_HZ - 1);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Write SMPLRT_DIV failed: %s", esp_err_to_name(err));
@@ -138,21 +166,9 @@ static void compute_angles(const mpu6050_accel_t *acc, mpu6050_angle_t *ang)
     ang->pitch = atan2f(acc->ax, acc->az) * rad2deg;
 }
 
-esp_err_t mpu6050_read_all(mpu6050_data_t *out)
+// Giải mã một khung 14 byte (thanh ghi ACCEL_XOUT_H..GYRO_ZOUT_L hoặc một mẫu FIFO)
+static void decode_sample(const uint8_t *buf, mpu6050_data_t *out)
 {
-    if (!s_ready || !out)
-    {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    uint8_t buf[14];
-    esp_err_t err = mpu_read_multi(MPU6050_REG_ACCEL_XOUT_H, buf, sizeof(buf));
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "mpu_read_multi failed: %s", esp_err_to_name(err));
-        return err;
-    }
-
     int16_t raw_ax = to_int16(buf[0], buf[1]);
     int16_t raw_ay = to_int16(buf[2], buf[3]);
     int16_t raw_az = to_int16(buf[4], buf[5]);
@@ -163,9 +179,9 @@ esp_err_t mpu6050_read_all(mpu6050_data_t *out)
 
     // Scale:
     // ACCEL ±2g => 16384 LSB/g
-    const float accel_scale = 1.0f / 16384.0f;
+    const float accel_scale = 1.0f / MPU6050_ACCEL_LSB_PER_G;
     // GYRO ±500 °/s => 65.5 LSB/(°/s)
-    const float gyro_scale = 1.0f / 65.5f;
+    const float gyro_scale = 1.0f / MPU6050_GYRO_LSB_PER_DPS;
 
     out->accel.ax = raw_ax * accel_scale;
     out->accel.ay = raw_ay * accel_scale;
@@ -179,10 +195,279 @@ esp_err_t mpu6050_read_all(mpu6050_data_t *out)
     out->temp.celsius = (raw_temp / 340.0f) + 36.53f;
 
     compute_angles(&out->accel, &out->angle);
+}
+
+// Giải mã phần accel + gyro của một khung 14 byte, bỏ nhiệt độ
+static void decode_raw(const uint8_t *buf, mpu6050_raw_t *out)
+{
+    for (int k = 0; k < 3; k++)
+    {
+        out->accel[k] = to_int16(buf[2 * k], buf[2 * k + 1]);
+        out->gyro[k] = to_int16(buf[8 + 2 * k], buf[8 + 2 * k + 1]);
+    }
+}
+
+esp_err_t mpu6050_read_all(mpu6050_data_t *out)
+{
+    if (!s_ready || !out)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t buf[MPU6050_FIFO_FRAME];
+    esp_err_t err = mpu_read_multi(MPU6050_REG_ACCEL_XOUT_H, buf, sizeof(buf));
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "mpu_read_multi failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    decode_sample(buf, out);
+    out->t_us = esp_timer_get_time();
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_read_raw(mpu6050_raw_t *out)
+{
+    if (!s_ready || !out)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
 
+    uint8_t buf[MPU6050_FIFO_FRAME];
+    esp_err_t err = mpu_read_multi(MPU6050_REG_ACCEL_XOUT_H, buf, sizeof(buf));
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "mpu_read_multi failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    decode_raw(buf, out);
     return ESP_OK;
 }
 
+static esp_err_t fifo_reset(void)
+{
+    // Tắt FIFO, xoá, rồi bật lại; bit FIFO_RESET tự về 0
+    esp_err_t err = mpu_write_reg(MPU6050_REG_USER_CTRL, 0x00);
+    if (err == ESP_OK)
+    {
+        err = mpu_write_reg(MPU6050_REG_USER_CTRL, MPU6050_USER_FIFO_RESET);
+    }
+    if (err == ESP_OK)
+    {
+        err = mpu_write_reg(MPU6050_REG_USER_CTRL, MPU6050_USER_FIFO_EN);
+    }
+    return err;
+}
+
+esp_err_t mpu6050_fifo_start(void)
+{
+    if (!s_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = mpu_write_reg(MPU6050_REG_FIFO_EN, MPU6050_FIFO_EN_ALL);
+    if (err == ESP_OK)
+    {
+        err = fifo_reset();
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "FIFO start failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "FIFO enabled, %d Hz, %d samples deep", MPU6050_SAMPLE_RATE_HZ, MPU6050_FIFO_MAX_SAMPLES);
+    return ESP_OK;
+}
+
+/*
+ * Đọc burst tối đa max_samples khung từ FIFO vào s_fifo_raw. *t_first_us là
+ * thời điểm của khung đầu, các khung sau cách nhau một chu kỳ lấy mẫu.
+ */
+static uint8_t s_fifo_raw[MPU6050_FIFO_MAX_SAMPLES * MPU6050_FIFO_FRAME];
+
+static esp_err_t fifo_burst(size_t max_samples, size_t *samples_read, bool *overflow, int64_t *t_first_us)
+{
+    *samples_read = 0;
+    *overflow = false;
+
+    uint8_t cnt[2];
+    esp_err_t err = mpu_read_multi(MPU6050_REG_FIFO_COUNT_H, cnt, sizeof(cnt));
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    int64_t t_read = esp_timer_get_time();
+    size_t bytes = ((size_t)cnt[0] << 8) | cnt[1];
+
+    // 1024 không chia hết cho 14: FIFO đầy thì mẫu cũ bị ghi đè và khung
+    // bị lệch, chỉ còn cách xoá FIFO. Khung đang ghi dở (số byte lẻ) để lần sau.
+    if (bytes > MPU6050_FIFO_MAX_SAMPLES * MPU6050_FIFO_FRAME)
+    {
+        *overflow = true;
+        return fifo_reset();
+    }
+
+    size_t pending = bytes / MPU6050_FIFO_FRAME;
+    size_t n = (pending < max_samples) ? pending : max_samples;
+    if (n == 0)
+    {
+        return ESP_OK;
+    }
+
+    err = mpu_read_multi(MPU6050_REG_FIFO_R_W, s_fifo_raw, n * MPU6050_FIFO_FRAME);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // Mẫu mới nhất trong FIFO vừa lấy xong lúc đọc FIFO_COUNT
+    *t_first_us = t_read - (int64_t)(pending - 1) * (1000000 / MPU6050_SAMPLE_RATE_HZ);
+    *samples_read = n;
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_read_fifo_raw(mpu6050_raw_t *out, size_t max_samples,
+                                size_t *samples_read, bool *overflow, int64_t *t_first_us)
+{
+    *samples_read = 0;
+    *overflow = false;
+    if (!s_ready || !out)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = fifo_burst(max_samples, samples_read, overflow, t_first_us);
+    for (size_t i = 0; i < *samples_read; i++)
+    {
+        decode_raw(&s_fifo_raw[i * MPU6050_FIFO_FRAME], &out[i]);
+    }
+    return err;
+}
+
+esp_err_t mpu6050_fifo_stop(void)
+{
+    if (!s_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return mpu_write_reg(MPU6050_REG_USER_CTRL, 0x00);
+}
+
+static uint8_t g_to_thr(float g)
+{
+    float lsb = g * 1000.0f / MPU6050_MG_PER_LSB;
+    return (lsb >= 255.0f) ? 255 : (lsb <= 1.0f) ? 1 : (uint8_t)lsb;
+}
+
+esp_err_t mpu6050_enable_events(float motion_g, uint8_t motion_ms)
+{
+    if (!s_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const uint8_t regs[][2] = {
+        {MPU6050_REG_ACCEL_CONFIG, MPU6050_ACCEL_2G_HPF_5HZ},
+        {MPU6050_REG_MOT_THR, g_to_thr(motion_g)},
+        {MPU6050_REG_MOT_DUR, motion_ms},
+        {MPU6050_REG_INT_PIN_CFG, MPU6050_INT_PIN_LATCH},
+        {MPU6050_REG_INT_ENABLE, MPU6050_EVENT_MOTION},
+    };
+
+    for (size_t i = 0; i < sizeof(regs) / sizeof(regs[0]); i++)
+    {
+        esp_err_t err = mpu_write_reg(regs[i][0], regs[i][1]);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Write reg 0x%02X failed: %s", regs[i][0], esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    ESP_LOGI(TAG, "Events: motion > %.2f g for %u ms", motion_g, motion_ms);
+    return ESP_OK;
+}
+
+static void IRAM_ATTR mpu6050_isr_handler(void *arg)
+{
+    BaseType_t higher_prio_woken = pdFALSE;
+
+    // Mức cao còn giữ tới khi task đọc INT_STATUS
+    gpio_intr_disable(s_int_pin);
+    if (s_int_task)
+    {
+        vTaskNotifyGiveFromISR(s_int_task, &higher_prio_woken);
+    }
+    portYIELD_FROM_ISR(higher_prio_woken);
+}
+
+esp_err_t mpu6050_int_init(gpio_num_t pin, TaskHandle_t task)
+{
+    if (pin == GPIO_NUM_NC)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    gpio_config_t int_conf = {
+        .intr_type = GPIO_INTR_HIGH_LEVEL,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << pin),
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,   // Không nối dây thì không có ngắt giả
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+    };
+
+    esp_err_t err = gpio_config(&int_conf);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // ISR service có thể đã được component khác cài
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        return err;
+    }
+
+    s_int_pin = pin;
+    s_int_task = task;
+    err = gpio_isr_handler_add(pin, mpu6050_isr_handler, NULL);
+    if (err == ESP_OK)
+    {
+        err = gpio_wakeup_enable(pin, GPIO_INTR_HIGH_LEVEL);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_sleep_enable_gpio_wakeup();
+    }
+    return err;
+}
+
+esp_err_t mpu6050_read_events(uint8_t *events)
+{
+    if (!s_ready || !events)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t status = 0;
+    esp_err_t err = mpu_read_reg(MPU6050_REG_INT_STATUS, &status);
+    ESP_LOGD(TAG, "INT_STATUS 0x%02X", status);
+    *events = status & MPU6050_EVENT_MOTION;
+
+    // Đọc INT_STATUS đã nhả chân INT
+    if (s_int_pin != GPIO_NUM_NC)
+    {
+        gpio_intr_enable(s_int_pin);
+    }
+    return err;
+}
+
 void mpu6050_deinit(void)
 {
     if (!s_ready)
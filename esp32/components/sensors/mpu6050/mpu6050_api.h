@@ -4,12 +4,25 @@
 #include <stdint.h>
 #include "esp_err.h"
 #include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+#define MPU6050_SAMPLE_RATE_HZ 100   // 1 kHz / (1 + SMPLRT_DIV), với DLPF bật
+#define MPU6050_FIFO_SIZE 1024       // Byte
+#define MPU6050_FIFO_FRAME 14        // Accel + temp + gyro, cùng thứ tự với ACCEL_XOUT_H..GYRO_ZOUT_L
+#define MPU6050_FIFO_MAX_SAMPLES (MPU6050_FIFO_SIZE / MPU6050_FIFO_FRAME)   // 73 mẫu = 730 ms
+#define MPU6050_ACCEL_LSB_PER_G 16384.0f    // Dải ±2 g
+#define MPU6050_GYRO_LSB_PER_DPS 65.5f      // Dải ±500 °/s
+
+// Bit của INT_STATUS trả về bởi mpu6050_read_events()
+#define MPU6050_EVENT_MOTION 0x40
+
     typedef struct
     {
         float ax;
@@ -41,8 +54,21 @@ extern "C"
         mpu6050_gyro_t gyro;
         mpu6050_temp_t temp;
         mpu6050_angle_t angle;
+        int64_t t_us; // Thời điểm lấy mẫu (esp_timer_get_time())
     } mpu6050_data_t;
 
+    /**
+     * @brief Mẫu thô (count int16 của cảm biến), 12 byte
+     * @details Không đổi sang float, không tính nhiệt độ hay góc; đổi đơn
+     *          vị bằng MPU6050_ACCEL_LSB_PER_G / MPU6050_GYRO_LSB_PER_DPS
+     *          khi cần.
+     */
+    typedef struct
+    {
+        int16_t accel[3]; // ax, ay, az
+        int16_t gyro[3];  // gx, gy, gz
+    } mpu6050_raw_t;
+
     /**
      * @brief Khởi tạo I2C + MPU6050
      *
@@ -58,6 +84,65 @@ extern "C"
      */
     esp_err_t mpu6050_read_all(mpu6050_data_t *out);
 
+    /**
+     * @brief Đọc accel + gyro dạng thô (một lần burst, bỏ qua nhiệt độ)
+     */
+    esp_err_t mpu6050_read_raw(mpu6050_raw_t *out);
+
+    /**
+     * @brief Bật FIFO phần cứng (accel + temp + gyro) ở MPU6050_SAMPLE_RATE_HZ
+     * @details Xoá FIFO trước khi bật, nên mẫu đầu tiên là mẫu mới. Sau khi
+     *          bật chỉ cần đọc FIFO định kỳ (< 730 ms một lần) thay vì đọc
+     *          từng mẫu.
+     */
+    esp_err_t mpu6050_fifo_start(void);
+
+    /**
+     * @brief Đọc hết các mẫu đang chờ trong FIFO bằng một lần burst FIFO_R_W
+     *
+     * @param out          Mảng nhận mẫu thô (count), cũ nhất trước
+     * @param max_samples  Số mẫu tối đa đọc lần này (phần còn lại đợi lần sau)
+     * @param samples_read Số mẫu đã đọc
+     * @param overflow     true nếu FIFO đã đầy và mất mẫu; FIFO được xoá để
+     *                     khớp lại khung 14 byte, lần đọc này không trả mẫu nào
+     * @param t_first_us   Thời điểm của out[0], tính lùi từ lúc đọc; mẫu i cách
+     *                     đó i chu kỳ lấy mẫu
+     */
+    esp_err_t mpu6050_read_fifo_raw(mpu6050_raw_t *out, size_t max_samples,
+                                    size_t *samples_read, bool *overflow, int64_t *t_first_us);
+
+    /**
+     * @brief Tắt FIFO (chế độ chờ), mpu6050_fifo_start() bật lại
+     */
+    esp_err_t mpu6050_fifo_stop(void);
+
+    /**
+     * @brief Bật bộ phát hiện chuyển động trên chip
+     * @details Gia tốc sau bộ lọc thông cao 5 Hz (DHPF) vượt motion_g trong
+     *          motion_ms. Ngưỡng 2 mg/LSB, thời gian 1 ms/LSB. Không dùng
+     *          rơi tự do: DHPF cũng đưa vào bộ phát hiện đó nên thiết bị nằm
+     *          yên đọc ~0 g và FF_INT bật liên tục; cú ngã nào cũng bắt đầu
+     *          bằng chuyển động. Chân INT mức cao, giữ (latch) tới khi
+     *          mpu6050_read_events() đọc INT_STATUS.
+     */
+    esp_err_t mpu6050_enable_events(float motion_g, uint8_t motion_ms);
+
+    /**
+     * @brief Nối chân INT của MPU6050 vào một task
+     * @details Ngắt theo mức cao: ISR tắt ngắt của chân rồi đánh thức task
+     *          (vTaskNotifyGiveFromISR), mpu6050_read_events() bật lại. Chân
+     *          cũng được bật làm nguồn đánh thức light sleep (GPIO wakeup).
+     * @param pin  GPIO nối với INT
+     * @param task Task nhận thông báo
+     */
+    esp_err_t mpu6050_int_init(gpio_num_t pin, TaskHandle_t task);
+
+    /**
+     * @brief Đọc và xoá cờ sự kiện (INT_STATUS), bật lại ngắt của chân INT
+     * @param events MPU6050_EVENT_MOTION nếu đã có chuyển động
+     */
+    esp_err_t mpu6050_read_events(uint8_t *events);
+
     /**
      * @brief Giải phóng driver I2C
      */
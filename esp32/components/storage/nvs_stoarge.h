@@ -2,6 +2,8 @@
 #define NVS_STORAGE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
 #include "sytem_config.h"
 
@@ -58,6 +60,68 @@ bool nvs_load_access_token(char *token);
 bool nvs_load_full_config(char *ssid, char *pass, char *patient, 
                           char *doctor, char *token);
 
+/**
+ * @brief Save the PPG sample rate applied at boot
+ * @param rate_hz Effective MAX30102 rate in Hz
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_ppg_sample_rate(uint16_t rate_hz);
+
+/**
+ * @brief Load the PPG sample rate applied at boot
+ * @param rate_hz Output for the effective rate in Hz
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_ppg_sample_rate(uint16_t *rate_hz);
+
+/**
+ * @brief Save the SpO2 calibration table of the sensor lot
+ * @param table Table blob (ppg_calib_table_t)
+ * @param len Size of the blob in bytes
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_spo2_calib(const void *table, size_t len);
+
+/**
+ * @brief Load the SpO2 calibration table of the sensor lot
+ * @param table Output buffer for the blob
+ * @param len Expected size in bytes; a stored blob of another size is ignored
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_spo2_calib(void *table, size_t len);
+
+/**
+ * @brief Save the fall detector thresholds of this unit
+ * @param config Config blob (fall_detect_config_t)
+ * @param len Size of the blob in bytes
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_fall_config(const void *config, size_t len);
+
+/**
+ * @brief Load the fall detector thresholds of this unit
+ * @param config Output buffer for the blob
+ * @param len Expected size in bytes; a stored blob of another size is ignored
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_fall_config(void *config, size_t len);
+
+/**
+ * @brief Save the fall classifier tree of this unit
+ * @param model Tree blob (fall_model_t)
+ * @param len Size of the blob in bytes
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_fall_model(const void *model, size_t len);
+
+/**
+ * @brief Load the fall classifier tree of this unit
+ * @param model Output buffer for the blob
+ * @param len Expected size in bytes; a stored blob of another size is ignored
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_fall_model(void *model, size_t len);
+
 /**
  * @brief Check if device provisioning is needed
  * @return true if provisioning needed, false otherwise
@@ -280,6 +280,194 @@ bool nvs_load_full_config(char *ssid, char *pass, char *patient,
     return success;
 }
 
+/**
+ * @brief Save the PPG sample rate applied at boot
+ * @param rate_hz Effective MAX30102 rate in Hz
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_ppg_sample_rate(uint16_t rate_hz) {
+    // Open NVS namespace
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_u16(nvs, NVS_KEY_PPG_RATE, rate_hz);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+
+    nvs_close(nvs);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "PPG sample rate saved: %u Hz", rate_hz);
+    } else {
+        ESP_LOGE(TAG, "Failed to save PPG sample rate: %s", esp_err_to_name(err));
+    }
+
+    return err;
+}
+
+/**
+ * @brief Load the PPG sample rate applied at boot
+ * @param rate_hz Output for the effective rate in Hz
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_ppg_sample_rate(uint16_t *rate_hz) {
+    if (!rate_hz) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+
+    // Open NVS namespace (read-only)
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    bool success = (nvs_get_u16(nvs, NVS_KEY_PPG_RATE, rate_hz) == ESP_OK);
+
+    nvs_close(nvs);
+    return success;
+}
+
+/**
+ * @brief Save a fixed-layout struct as one blob
+ * @param key NVS key
+ * @param what Name of the contents for the log
+ * @param data Blob to store
+ * @param len Size of the blob in bytes
+ * @return ESP_OK on success
+ */
+static esp_err_t nvs_save_blob(const char *key, const char *what, const void *data, size_t len) {
+    if (!data || len == 0) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Open NVS namespace
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(nvs, key, data, len);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+
+    nvs_close(nvs);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "%s saved (%u bytes)", what, (unsigned)len);
+    } else {
+        ESP_LOGE(TAG, "Failed to save %s: %s", what, esp_err_to_name(err));
+    }
+
+    return err;
+}
+
+/**
+ * @brief Load a blob saved by nvs_save_blob()
+ * @param key NVS key
+ * @param what Name of the contents for the log
+ * @param data Output buffer for the blob
+ * @param len Expected size in bytes; a stored blob of another size is ignored
+ * @return true if loaded successfully, false otherwise
+ */
+static bool nvs_load_blob(const char *key, const char *what, void *data, size_t len) {
+    if (!data || len == 0) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+
+    // Open NVS namespace (read-only)
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    // Check the stored size first: a blob from another layout is not read
+    size_t stored = 0;
+    bool success = (nvs_get_blob(nvs, key, NULL, &stored) == ESP_OK) &&
+                   (stored == len) &&
+                   (nvs_get_blob(nvs, key, data, &stored) == ESP_OK);
+
+    nvs_close(nvs);
+
+    if (!success && stored != 0 && stored != len) {
+        ESP_LOGW(TAG, "Stored %s has %u bytes, expected %u",
+                 what, (unsigned)stored, (unsigned)len);
+    }
+    return success;
+}
+
+/**
+ * @brief Save the SpO2 calibration table of the sensor lot
+ * @param table Table blob (ppg_calib_table_t)
+ * @param len Size of the blob in bytes
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_spo2_calib(const void *table, size_t len) {
+    return nvs_save_blob(NVS_KEY_SPO2_CALIB, "SpO2 calibration", table, len);
+}
+
+/**
+ * @brief Load the SpO2 calibration table of the sensor lot
+ * @param table Output buffer for the blob
+ * @param len Expected size in bytes; a stored blob of another size is ignored
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_spo2_calib(void *table, size_t len) {
+    return nvs_load_blob(NVS_KEY_SPO2_CALIB, "SpO2 calibration", table, len);
+}
+
+/**
+ * @brief Save the fall detector thresholds of this unit
+ * @param config Config blob (fall_detect_config_t)
+ * @param len Size of the blob in bytes
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_fall_config(const void *config, size_t len) {
+    return nvs_save_blob(NVS_KEY_FALL_CONFIG, "fall thresholds", config, len);
+}
+
+/**
+ * @brief Load the fall detector thresholds of this unit
+ * @param config Output buffer for the blob
+ * @param len Expected size in bytes; a stored blob of another size is ignored
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_fall_config(void *config, size_t len) {
+    return nvs_load_blob(NVS_KEY_FALL_CONFIG, "fall thresholds", config, len);
+}
+
+/**
+ * @brief Save the fall classifier tree of this unit
+ * @param model Tree blob (fall_model_t)
+ * @param len Size of the blob in bytes
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_save_fall_model(const void *model, size_t len) {
+    return nvs_save_blob(NVS_KEY_FALL_MODEL, "fall classifier tree", model, len);
+}
+
+/**
+ * @brief Load the fall classifier tree of this unit
+ * @param model Output buffer for the blob
+ * @param len Expected size in bytes; a stored blob of another size is ignored
+ * @return true if loaded successfully, false otherwise
+ */
+bool nvs_load_fall_model(void *model, size_t len) {
+    return nvs_load_blob(NVS_KEY_FALL_MODEL, "fall classifier tree", model, len);
+}
+
 /**
  * @brief Check if device provisioning is needed
  * @return true if provisioning needed, false otherwise
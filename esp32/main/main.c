@@ -2,6 +2,7 @@
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
@@ -21,11 +22,16 @@
 #include "temperature.h"
 #include "heart_rate.h"
 #include "mpu6050_api.h"
+#include "imu_fusion.h"
+#include "fall_detect.h"
+#include "fall_capture.h"
 #include "oled_display.h"
 #include "u8g2_esp32_hal.h"
 #include "sys_button.h"
 #include "alarm_manager.h"
 #include "provisioning.h"
+#include "task_map.h"
+#include "ppg_calib.h"
 
 static const char *TAG = "MAIN";
 EventGroupHandle_t g_event_group = NULL;
@@ -38,11 +44,25 @@ static struct {
     float temperature;
     int heart_rate;
     double spo2;
+    bool ppg_valid;
+    ppg_hrv_t hrv;
+    float resp_rate;
+    float perfusion_index;
+    uint8_t confidence;
+    uint16_t beats;
 } s_sensor_data = {0};
+static heart_rate_stats_t s_last_ppg_stats = {0};   // Last published acquisition counters
+static volatile bool s_calib_reported = false;       // Active SpO2 calibration sent as attributes
 
 // FreeRTOS queues
 static QueueHandle_t s_oled_queue = NULL;
 static QueueHandle_t g_mpu_queue = NULL;
+static volatile int32_t s_mpu_sample_us = 1000000 / MPU6050_SAMPLE_RATE_HZ;    // Spacing of queued samples
+static volatile fall_state_t s_fall_state = FALL_ST_IDLE;    // Written by the fall detector
+static fall_detect_t s_fall_detector;                          // Owned by the fall detector task
+static fall_capture_t s_fall_capture;                           // Raw IMU around the last fall, sent by the MQTT task
+static volatile fall_source_t s_fall_capture_source;
+static uint16_t s_ppg_rate_hz = HEART_RATE_SAMPLE_RATE_HZ;    // Stored rate, used from the next boot
 
 /**
  * @brief Temperature sensor update callback
@@ -57,6 +77,242 @@ static void on_temperature_update(float temp) {
 static void on_heart_rate_update(heart_rate_data_t data) {
     s_sensor_data.heart_rate = data.heart_rate;
     s_sensor_data.spo2 = data.spo2;
+    s_sensor_data.ppg_valid = data.valid;
+    s_sensor_data.hrv = data.hrv;
+    s_sensor_data.resp_rate = data.resp_rate;
+    s_sensor_data.perfusion_index = data.perfusion_index;
+    s_sensor_data.confidence = data.confidence;
+    s_sensor_data.beats = data.beats;
+}
+
+/**
+ * @brief Value of a shared attribute, parsed first if it came as a JSON string
+ * @param parsed Set to the parsed tree, to cJSON_Delete() once done (NULL if none)
+ */
+static const cJSON *attr_unwrap(const cJSON *value, cJSON **parsed) {
+    *parsed = NULL;
+    if (cJSON_IsString(value)) {
+        *parsed = cJSON_Parse(value->valuestring);
+        return *parsed;
+    }
+    return value;
+}
+
+/**
+ * @brief SpO2 calibration pushed as the SPO2_CALIB_ATTR shared attribute
+ * @details {"lot":"A23","r":[0.4,0.7,1.0,1.6],"spo2":[100,96,88,70]}, as a
+ *          JSON object or a string holding one. The periodic attribute
+ *          request returns the same table every time, so a table equal to
+ *          the active one is ignored and NVS is only written for a new lot.
+ */
+static void on_spo2_calib_attribute(const cJSON *value) {
+    cJSON *parsed;
+    value = attr_unwrap(value, &parsed);
+
+    const cJSON *lot = cJSON_GetObjectItemCaseSensitive(value, "lot");
+    const cJSON *r = cJSON_GetObjectItemCaseSensitive(value, "r");
+    const cJSON *spo2 = cJSON_GetObjectItemCaseSensitive(value, "spo2");
+    int points = cJSON_GetArraySize(r);
+
+    ppg_calib_table_t table;
+    memset(&table, 0, sizeof(table));   // Unused points compare equal below
+    table.version = PPG_CALIB_VERSION;
+
+    bool ok = cJSON_IsArray(r) && cJSON_IsArray(spo2) &&
+              points == cJSON_GetArraySize(spo2) && points <= PPG_CALIB_MAX_POINTS;
+    if (ok) {
+        table.count = (uint8_t)points;
+        if (cJSON_IsString(lot)) {
+            strncpy(table.lot, lot->valuestring, sizeof(table.lot) - 1);
+        }
+        for (int i = 0; i < points && ok; i++) {
+            const cJSON *ri = cJSON_GetArrayItem(r, i);
+            const cJSON *si = cJSON_GetArrayItem(spo2, i);
+            ok = cJSON_IsNumber(ri) && cJSON_IsNumber(si);
+            if (ok) {
+                table.r[i] = (float)ri->valuedouble;
+                table.spo2[i] = (float)si->valuedouble;
+            }
+        }
+    }
+    cJSON_Delete(parsed);
+
+    if (!ok || !ppg_calib_validate(&table)) {
+        ESP_LOGW(TAG, "SpO2 calibration rejected (need 2..%d points, R increasing)",
+                 PPG_CALIB_MAX_POINTS);
+        return;
+    }
+    if (memcmp(&table, ppg_calib_get(), sizeof(table)) == 0) {
+        return;
+    }
+
+    ppg_calib_set(&table);
+    nvs_save_spo2_calib(&table, sizeof(table));
+    s_calib_reported = false;
+    ESP_LOGI(TAG, "SpO2 calibration of lot '%s' applied (%d points)", table.lot, points);
+}
+
+/**
+ * @brief Effective PPG rate pushed as the PPG_RATE_ATTR shared attribute
+ * @details A number of Hz (25, 50, 100...) or a string holding one. The
+ *          rate is saved to NVS and applied by heart_rate_sensor_init() at
+ *          the next boot or wake from deep sleep: switching it under a
+ *          running stream would invalidate the algorithm context. A rate
+ *          equal to the stored one is ignored.
+ */
+static void on_ppg_rate_attribute(const cJSON *value) {
+    cJSON *parsed;
+    value = attr_unwrap(value, &parsed);
+    double hz = cJSON_IsNumber(value) ? value->valuedouble : -1;
+    cJSON_Delete(parsed);
+
+    if (!(hz >= 1 && hz <= UINT16_MAX) || hz != (uint16_t)hz ||
+        !heart_rate_sample_rate_supported((uint16_t)hz)) {
+        ESP_LOGW(TAG, "PPG sample rate rejected (need 25, 50 or 100 Hz)");
+        return;
+    }
+    if ((uint16_t)hz == s_ppg_rate_hz) {
+        return;
+    }
+
+    if (nvs_save_ppg_sample_rate((uint16_t)hz) == ESP_OK) {
+        s_ppg_rate_hz = (uint16_t)hz;
+        ESP_LOGI(TAG, "PPG sample rate %u Hz applies from the next boot", s_ppg_rate_hz);
+    }
+}
+
+/**
+ * @brief Read one number of a config attribute
+ * @return false if the key is present but not a number; a missing key
+ *         keeps the field
+ */
+static bool attr_float(const cJSON *obj, const char *key, float *field) {
+    const cJSON *v = cJSON_GetObjectItemCaseSensitive(obj, key);
+    if (!v) {
+        return true;
+    }
+    if (!cJSON_IsNumber(v)) {
+        return false;
+    }
+    *field = (float)v->valuedouble;
+    return true;
+}
+
+static bool attr_u16(const cJSON *obj, const char *key, uint16_t *field) {
+    float f = *field;
+    if (!attr_float(obj, key, &f) || !(f >= 0 && f <= UINT16_MAX)) {
+        return false;
+    }
+    *field = (uint16_t)f;
+    return true;
+}
+
+/**
+ * @brief Fall detector thresholds pushed as the FALL_CONFIG_ATTR shared attribute
+ * @details {"ffG":0.35,"ffMinMs":120,"ffMaxMs":1000,"impactG":1.0,
+ *          "impactTimeoutMs":300,"postInactDps":10,"postAngleDeg":45,
+ *          "uprightAxis":0,"postWindowMs":1500,"cooldownMs":3000}, as a
+ *          JSON object or a string holding one. Missing keys keep their
+ *          active value. As for the SpO2 table, a config equal to the
+ *          active one is ignored, so NVS is only written on a change.
+ */
+static void on_fall_config_attribute(const cJSON *value) {
+    cJSON *parsed;
+    value = attr_unwrap(value, &parsed);
+
+    fall_detect_config_t cfg = *fall_detect_config();
+    uint16_t axis = cfg.upright_axis;
+    bool ok = cJSON_IsObject(value) &&
+              attr_float(value, "ffG", &cfg.ff_g) &&
+              attr_u16(value, "ffMinMs", &cfg.ff_min_ms) &&
+              attr_u16(value, "ffMaxMs", &cfg.ff_max_ms) &&
+              attr_float(value, "impactG", &cfg.impact_g) &&
+              attr_u16(value, "impactTimeoutMs", &cfg.impact_timeout_ms) &&
+              attr_float(value, "postInactDps", &cfg.post_inact_dps) &&
+              attr_float(value, "postAngleDeg", &cfg.post_angle_deg) &&
+              attr_u16(value, "uprightAxis", &axis) &&
+              attr_u16(value, "postWindowMs", &cfg.post_window_ms) &&
+              attr_u16(value, "cooldownMs", &cfg.cooldown_ms);
+    cfg.upright_axis = (axis > UINT8_MAX) ? UINT8_MAX : (uint8_t)axis;
+    cJSON_Delete(parsed);
+
+    if (!ok || !fall_detect_validate(&cfg)) {
+        ESP_LOGW(TAG, "Fall thresholds rejected");
+        return;
+    }
+    if (memcmp(&cfg, fall_detect_config(), sizeof(cfg)) == 0) {
+        return;
+    }
+
+    fall_detect_set_config(&cfg);
+    nvs_save_fall_config(&cfg, sizeof(cfg));
+    ESP_LOGI(TAG, "Fall thresholds applied: FF < %.2fg for %u..%u ms, impact > %.2fg within %u ms, "
+             "still < %.0fdps and tilt > %.0f° (axis %u) within %u ms",
+             cfg.ff_g, cfg.ff_min_ms, cfg.ff_max_ms, cfg.impact_g, cfg.impact_timeout_ms,
+             cfg.post_inact_dps, cfg.post_angle_deg, cfg.upright_axis, cfg.post_window_ms);
+}
+
+/**
+ * @brief Fall classifier tree pushed as the FALL_MODEL_ATTR shared attribute
+ * @details {"enabled":1,"nodes":[[5,45,1,2],[-1,0],...]}: per node the
+ *          feature (fall_feature_t), threshold, node below and node at or
+ *          above; [-1, class] is a leaf. "enabled":0 alone turns the
+ *          classifier off and keeps the tree. A JSON string holding the
+ *          object works too; a tree equal to the active one is ignored.
+ */
+static void on_fall_model_attribute(const cJSON *value) {
+    cJSON *parsed;
+    value = attr_unwrap(value, &parsed);
+
+    const cJSON *enabled = cJSON_GetObjectItemCaseSensitive(value, "enabled");
+    const cJSON *nodes = cJSON_GetObjectItemCaseSensitive(value, "nodes");
+    int count = cJSON_GetArraySize(nodes);
+
+    fall_model_t model = *fall_model_get();
+    bool ok = cJSON_IsObject(value);
+    if (ok && enabled) {
+        ok = cJSON_IsNumber(enabled) || cJSON_IsBool(enabled);
+        model.enabled = cJSON_IsBool(enabled) ? cJSON_IsTrue(enabled) : (enabled->valuedouble != 0);
+    }
+
+    if (ok && nodes) {
+        memset(model.node, 0, sizeof(model.node));   // Unused nodes compare equal below
+        ok = cJSON_IsArray(nodes) && count > 0 && count <= FALL_MODEL_MAX_NODES;
+        model.count = ok ? (uint8_t)count : 0;
+        for (int i = 0; i < count && ok; i++) {
+            const cJSON *node = cJSON_GetArrayItem(nodes, i);
+            int fields = cJSON_GetArraySize(node);
+            double v[4] = {0};
+            ok = cJSON_IsArray(node) && fields >= 2 && fields <= 4;
+            for (int k = 0; k < fields && ok; k++) {
+                const cJSON *item = cJSON_GetArrayItem(node, k);
+                ok = cJSON_IsNumber(item) && fabs(item->valuedouble) < INT32_MAX;
+                v[k] = ok ? item->valuedouble : 0;
+            }
+            ok = ok && (v[0] < 0 || fields == 4) && v[0] < FALL_MODEL_LEAF &&
+                 v[2] >= 0 && v[2] < FALL_MODEL_MAX_NODES && v[3] >= 0 && v[3] < FALL_MODEL_MAX_NODES;
+            if (ok) {
+                model.node[i].feature = (v[0] < 0) ? FALL_MODEL_LEAF : (uint8_t)v[0];
+                model.node[i].threshold = (int32_t)v[1];
+                model.node[i].below = (uint8_t)v[2];
+                model.node[i].above = (uint8_t)v[3];
+            }
+        }
+    }
+    cJSON_Delete(parsed);
+
+    if (!ok || !fall_model_validate(&model)) {
+        ESP_LOGW(TAG, "Fall classifier tree rejected (1..%d nodes, children after their parent)",
+                 FALL_MODEL_MAX_NODES);
+        return;
+    }
+    if (memcmp(&model, fall_model_get(), sizeof(model)) == 0) {
+        return;
+    }
+
+    fall_model_set(&model);
+    nvs_save_fall_model(&model, sizeof(model));
+    ESP_LOGI(TAG, "Fall classifier %s (%d nodes)", model.enabled ? "applied" : "disabled", model.count);
 }
 
 /**
@@ -81,6 +337,46 @@ static void oled_update_task(void *param) {
     }
 }
 
+/**
+ * @brief Send the frozen fall capture as a "fallEvent" telemetry record
+ * @details Built in a static buffer sized for the longest encoding, so
+ *          nothing is allocated here. The capture is released (and records
+ *          again) only once the publish is accepted; until then it is
+ *          retried every round. delayMs dates the trigger, as the device
+ *          has no wall clock.
+ */
+static void publish_fall_capture(void) {
+    static char payload[FALL_CAPTURE_TEXT_MAX + 320];
+    uint32_t pre;
+    uint32_t samples = fall_capture_count(&s_fall_capture, &pre);
+    int64_t delay_ms = (esp_timer_get_time() - s_fall_capture.t_trigger_us) / 1000;
+
+    int head = snprintf(payload, sizeof(payload),
+        "{\"fallEvent\":{\"source\":\"%s\",\"delayMs\":%lld,\"rateHz\":%d,\"samples\":%lu,\"pre\":%lu,"
+        "\"accLsbPerG\":%.0f,\"gyroLsbPerDps\":%.1f,\"encoding\":\"delta-zigzag-varint-base64\",\"data\":\"",
+        s_fall_capture_source == FALL_SOURCE_CLASSIFIER ? "classifier" : "stateMachine",
+        (long long)delay_ms, MPU6050_SAMPLE_RATE_HZ, (unsigned long)samples, (unsigned long)pre,
+        MPU6050_ACCEL_LSB_PER_G, MPU6050_GYRO_LSB_PER_DPS);
+    if (head < 0 || head >= sizeof(payload)) {
+        ESP_LOGE(TAG, "Failed to build fall event payload");
+        return;
+    }
+
+    size_t len = fall_capture_encode(&s_fall_capture, payload + head, sizeof(payload) - head);
+    if (len == 0 || head + len + sizeof("\"}}") > sizeof(payload)) {
+        ESP_LOGE(TAG, "Failed to encode fall capture, dropped");
+        fall_capture_release(&s_fall_capture);
+        return;
+    }
+    memcpy(payload + head + len, "\"}}", sizeof("\"}}"));
+
+    if (mqtt_publish_fall_event(payload, head + len + sizeof("\"}}") - 1) == ESP_OK) {
+        ESP_LOGI(TAG, "Fall capture sent: %lu samples (%lu before the trigger) in %u chars",
+                 (unsigned long)samples, (unsigned long)pre, (unsigned)len);
+        fall_capture_release(&s_fall_capture);
+    }
+}
+
 /**
  * @brief MQTT telemetry sending task
  * @details Checks health data, updates alarm status, and publishes to MQTT
@@ -102,24 +398,68 @@ static void mqtt_send_task(void *param) {
             alarm_check_health_data(
                 s_sensor_data.heart_rate, 
                 s_sensor_data.spo2, 
-                s_sensor_data.temperature
+                s_sensor_data.temperature,
+                s_sensor_data.ppg_valid,
+                s_sensor_data.confidence
             );
             
             // Get alarm status string
             char alarm_str[128] = {0};
             alarm_get_string(alarm_str);
 
-            // Publish telemetry data
+            // Publish telemetry data; HR/SpO2 only when the reading can be trusted
+            bool ppg_reliable = s_sensor_data.ppg_valid &&
+                                s_sensor_data.confidence >= HEART_RATE_CONFIDENCE_MIN;
             esp_err_t err = mqtt_publish_telemetry(
                 s_sensor_data.heart_rate,
                 s_sensor_data.spo2,
                 s_sensor_data.temperature,
-                alarm_str
+                alarm_str,
+                ppg_reliable
             );
 
             if (err != ESP_OK) {
                 ESP_LOGW(TAG, "Failed to publish telemetry");
             }
+
+            // Signal quality whenever there is a reading, so dropouts can be explained
+            if (s_sensor_data.ppg_valid) {
+                mqtt_publish_ppg_quality(s_sensor_data.perfusion_index, s_sensor_data.confidence,
+                                         s_sensor_data.beats);
+            }
+
+            // HRV only once enough beat-to-beat intervals are available
+            ppg_hrv_t hrv = s_sensor_data.hrv;
+            if (ppg_reliable && hrv.intervals >= HEART_RATE_HRV_MIN_RR) {
+                mqtt_publish_hrv(hrv.sdnn_ms, hrv.rmssd_ms, hrv.pnn50, hrv.last_rr_ms);
+            }
+
+            // Respiratory rate only when its modulations agreed
+            if (ppg_reliable && s_sensor_data.resp_rate > 0) {
+                mqtt_publish_resp_rate(s_sensor_data.resp_rate);
+            }
+
+            // Waveform around the last fall, once its post-trigger window is in
+            if (fall_capture_frozen(&s_fall_capture)) {
+                publish_fall_capture();
+            }
+
+            // Calibration lot in use, once per change
+            if (!s_calib_reported) {
+                const ppg_calib_table_t *calib = ppg_calib_get();
+                s_calib_reported = (mqtt_publish_spo2_calib(calib->lot, calib->count) == ESP_OK);
+            }
+
+            // Acquisition losses only when they change
+            heart_rate_stats_t stats;
+            heart_rate_get_stats(&stats);
+            if (stats.fifo_overflows != s_last_ppg_stats.fifo_overflows ||
+                stats.frames_dropped != s_last_ppg_stats.frames_dropped) {
+                if (mqtt_publish_ppg_stats(stats.samples, stats.fifo_overflows,
+                                           stats.frames_dropped) == ESP_OK) {
+                    s_last_ppg_stats = stats;
+                }
+            }
         }
 
         vTaskDelay(pdMS_TO_TICKS(MQTT_SEND_DELAY_MS));
@@ -285,75 +625,165 @@ static esp_err_t do_provisioning_if_needed(void) {
     return ESP_OK;
 }
 
+/**
+ * @brief Queue one IMU sample for the fall detector
+ * @details Only the 12 raw bytes are queued: samples are s_mpu_sample_us
+ *          apart, so the detector keeps its own sample clock.
+ *          Queue full: the oldest sample is dropped, the detector needs the newest
+ */
+static void mpu6050_queue_sample(const mpu6050_raw_t *raw, int64_t t_us) {
+    // Motion reference for the PPG artifact canceller
+    const float g = 1.0f / MPU6050_ACCEL_LSB_PER_G;
+    heart_rate_push_motion(t_us, raw->accel[0] * g, raw->accel[1] * g, raw->accel[2] * g);
+
+    if (xQueueSend(g_mpu_queue, raw, 0) != pdPASS) {
+        mpu6050_raw_t trash;
+        xQueueReceive(g_mpu_queue, &trash, 0);
+
+        if (xQueueSend(g_mpu_queue, raw, 0) != pdPASS) {
+            ESP_LOGW(TAG, "Queue full, dropped newest sample");
+        }
+    }
+}
+
+/**
+ * @brief Wait in low-rate mode until the MPU6050 flags motion
+ * @details The FIFO is off; the task sleeps on the INT notification and
+ *          reads INT_STATUS once per MPU_IDLE_CHECK_MS in case an edge was
+ *          missed (the status is latched).
+ * @return Events that ended the wait
+ */
+static uint8_t mpu6050_wait_event(void) {
+    uint8_t events = 0;
+
+    while (events == 0) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MPU_IDLE_CHECK_MS));
+        if (mpu6050_read_events(&events) != ESP_OK) {
+            events = 0;
+        }
+    }
+    return events;
+}
+
+/**
+ * @brief End of the capture hold started now: the span of a fall under the active thresholds
+ */
+static int64_t capture_until(void) {
+    return esp_timer_get_time() + fall_detect_span_ms(fall_detect_config()) * 1000LL;
+}
+
 /**
  * @brief MPU6050 sensor reading task (Producer)
- * @details Periodically reads sensor data and pushes to queue
+ * @details While capturing, wakes every MPU_PERIOD_MS and drains the
+ *          hardware FIFO, so the fall detector sees every sample at
+ *          MPU6050_SAMPLE_RATE_HZ with one burst read per period. Without
+ *          the FIFO it falls back to one register snapshot per period.
+ *
+ *          With MPU6050_INT_PIN wired, capture stops once nothing has
+ *          moved for the span of a fall and the detector is idle; the
+ *          chip's own motion detector then restarts it (a fall starts
+ *          with motion; the free-fall detector sits behind the same
+ *          high-pass filter and would fire at rest). A still
+ *          patient costs one INT_STATUS read per MPU_IDLE_CHECK_MS (1 Hz)
+ *          instead of a FIFO burst per period, and the PPG motion
+ *          reference simply lapses (there is no motion to cancel).
  */
 static void mpu6050_task(void *param) {
     ESP_LOGI(TAG, "MPU6050 task started");
 
+    static mpu6050_raw_t batch[MPU_FIFO_BATCH];
+    bool fifo = mpu6050_is_ready() && mpu6050_fifo_start() == ESP_OK;
+    if (!fifo) {
+        ESP_LOGW(TAG, "MPU6050 FIFO unavailable, polling every %d ms", MPU_PERIOD_MS);
+        s_mpu_sample_us = MPU_PERIOD_MS * 1000;
+    }
+
+    bool wake_on_event = fifo &&
+        mpu6050_enable_events(MPU_WAKE_MOTION_G, MPU_WAKE_MOTION_MS) == ESP_OK &&
+        mpu6050_int_init(MPU6050_INT_PIN, xTaskGetCurrentTaskHandle()) == ESP_OK;
+    int64_t active_until = capture_until();
+
+    task_jitter_t jitter;
+    task_jitter_init(&jitter, "mpu6050");
+    TickType_t wake = xTaskGetTickCount();
+
     while (1) {
-        mpu6050_data_t data = {0};
+        task_jitter_mark(&jitter, esp_timer_get_time(), MPU_PERIOD_MS * 1000);
         
-        if (mpu6050_is_ready()) {
-            esp_err_t err = mpu6050_read_all(&data);
+        if (!mpu6050_is_ready()) {
+            ESP_LOGW(TAG, "MPU6050 not ready");
+        } else if (fifo) {
+            size_t got = 0;
+            bool overflow = false;
+            int64_t t_first = 0;
+            esp_err_t err = mpu6050_read_fifo_raw(batch, MPU_FIFO_BATCH, &got, &overflow, &t_first);
+
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "MPU6050 FIFO read failed: %s", esp_err_to_name(err));
+            } else if (overflow) {
+                ESP_LOGW(TAG, "MPU6050 FIFO overflow, samples lost");
+            }
+            for (size_t i = 0; i < got; i++) {
+                mpu6050_queue_sample(&batch[i], t_first + (int64_t)i * s_mpu_sample_us);
+            }
+        } else {
+            mpu6050_raw_t raw;
+            esp_err_t err = mpu6050_read_raw(&raw);
             
             if (err == ESP_OK) {
-                // Try to send to queue
-                if (xQueueSend(g_mpu_queue, &data, 0) != pdPASS) {
-                    // Queue full - drop oldest sample
-                    mpu6050_data_t trash;
-                    xQueueReceive(g_mpu_queue, &trash, 0);
-                    
-                    if (xQueueSend(g_mpu_queue, &data, 0) != pdPASS) {
-                        ESP_LOGW(TAG, "Queue full, dropped newest sample");
-                    }
-                }
+                mpu6050_queue_sample(&raw, esp_timer_get_time());
             } else {
                 ESP_LOGW(TAG, "MPU6050 read failed: %s", esp_err_to_name(err));
             }
-        } else {
-            ESP_LOGW(TAG, "MPU6050 not ready");
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(MPU_PERIOD_MS));
-    }
-}
-
-/**
- * @brief Calculate vector norm (magnitude)
- */
-static inline float vec3_norm(float x, float y, float z) {
-    return sqrtf(x * x + y * y + z * z);
-}
 
+        if (wake_on_event) {
+            // Any motion flagged since the last period keeps the capture going
+            uint8_t events = 0;
+            if (ulTaskNotifyTake(pdTRUE, 0) && mpu6050_read_events(&events) == ESP_OK && events) {
+                active_until = capture_until();
+            }
 
-/**
- * @brief Convert fall state to string (for debugging)
- */
-static const char *fall_state_to_str(fall_state_t s) {
-    switch (s) {
-        case ST_IDLE:         return "IDLE";
-        case ST_FREE_FALL:    return "FREE_FALL";
-        case ST_IMPACT_WAIT:  return "IMPACT_WAIT";
-        case ST_POST_MONITOR: return "POST_MONITOR";
-        default:              return "UNKNOWN";
+            // A fall capture still recording its post-trigger window keeps it going too
+            if (esp_timer_get_time() > active_until && s_fall_state == FALL_ST_IDLE &&
+                s_fall_capture.state != FALL_CAPTURE_POST_TRIGGER && mpu6050_fifo_stop() == ESP_OK) {
+                ESP_LOGI(TAG, "IMU still, waiting for a motion interrupt");
+                mpu6050_wait_event();
+                ESP_LOGI(TAG, "IMU woken by motion");
+
+                // Confirmation window at full rate, from a fresh FIFO; the
+                // queue drained long ago, so nothing from before the idle is in flight
+                mpu6050_fifo_start();
+                fall_capture_gap(&s_fall_capture);
+                fall_detect_gap(&s_fall_detector);
+                active_until = capture_until();
+                wake = xTaskGetTickCount();
+                jitter.last_us = 0;     // The idle gap is not jitter
+            }
+        }
+        
+        // Fixed-rate schedule: the read time does not add to the period
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(MPU_PERIOD_MS));
     }
 }
 
 /**
  * @brief Fall detection task (Consumer)
- * @details Processes MPU6050 data and detects fall events
+ * @details Runs every MPU6050 sample through the fall_detect state machine
+ *          and window classifier with the thresholds and tree active at
+ *          that sample, and into the fall capture ring, which a fall
+ *          triggers. Samples stay raw counts throughout; the sample time
+ *          advances by s_mpu_sample_us per sample (an idle gap in the
+ *          capture adds nothing, the detector is idle across it).
  */
 static void handle_mpu6050_data(void *param) {
     ESP_LOGI(TAG, "Fall detector started");
 
-    fall_state_t state = ST_IDLE;
-    fall_state_t prev_state = state;
-    TickType_t t_state = 0;
-    TickType_t t_last_report = 0;
-
-    mpu6050_data_t data;
+    fall_state_t prev_state = FALL_ST_IDLE;
+    mpu6050_raw_t data;
+    int64_t t_us = 0;
+    fall_detect_init(&s_fall_detector);
+    fall_capture_init(&s_fall_capture);
 
     while (1) {
         // Wait for sensor data
@@ -361,90 +791,46 @@ static void handle_mpu6050_data(void *param) {
             continue;
         }
 
-        // Calculate magnitudes
-        const float acc_norm = vec3_norm(data.accel.ax, data.accel.ay, data.accel.az);
-        const float gyro_norm = vec3_norm(data.gyro.gx, data.gyro.gy, data.gyro.gz);
-        const TickType_t now = xTaskGetTickCount();
-
-        // Fall detection state machine
-        switch (state) {
-            case ST_IDLE:
-                // Check for free-fall condition
-                if (acc_norm < FF_G_THRESH) {
-                    state = ST_FREE_FALL;
-                    t_state = now;
-                    ESP_LOGI(TAG, "Free-fall detected!");
-                }
-                break;
-
-            case ST_FREE_FALL: {
-                TickType_t elapsed = now - t_state;
-                
-                if (acc_norm < FF_G_THRESH) {
-                    // Still in free-fall
-                    if (elapsed > pdMS_TO_TICKS(FF_MAX_TIME_MS)) {
-                        // Free-fall too long, reset
-                        state = ST_IDLE;
-                    }
-                } else {
-                    // Free-fall ended, wait for impact
-                    state = ST_IMPACT_WAIT;
-                    t_state = now;
-                }
-                break;
-            }
-
-            case ST_IMPACT_WAIT: {
-                TickType_t elapsed = now - t_state;
-                
-                if (acc_norm > IMPACT_G_THRESH) {
-                    // Impact detected!
-                    state = ST_POST_MONITOR;
-                    t_state = now;
-                    ESP_LOGI(TAG, "Impact detected! |acc|=%.2fg", acc_norm);
-                } else if (elapsed > pdMS_TO_TICKS(IMPACT_TIMEOUT_MS)) {
-                    // No impact, reset
-                    state = ST_IDLE;
-                }
-                break;
-            }
+        t_us += s_mpu_sample_us;
+        bool fall = fall_detect_process(&s_fall_detector, t_us, data.accel, data.gyro);
 
-            case ST_POST_MONITOR: {
-                TickType_t elapsed = now - t_state;
-                bool low_motion = (gyro_norm < POST_INACT_DPS);
-                
-                if (low_motion) {
-                    // Person is inactive after impact - likely a fall!
-                    if ((now - t_last_report) > pdMS_TO_TICKS(REPORT_COOLDOWN_MS)) {
-                        t_last_report = now;
-                        
-                        ESP_LOGW(TAG, "[FALL DETECTED!] |acc|=%.2fg, |gyro|=%.0fdps, "
-                                 "roll=%.1f°, pitch=%.1f°", 
-                                 acc_norm, gyro_norm, 
-                                 data.angle.roll, data.angle.pitch);
-                        
-                        // Trigger fall alarm
-                        alarm_fall_detection();
-                    }
-                    state = ST_IDLE;
-                } else if (elapsed > pdMS_TO_TICKS(POST_WINDOW_MS)) {
-                    // Person moved after impact - probably not a fall
-                    state = ST_IDLE;
-                }
-                break;
-            }
+        int16_t counts[FALL_CAPTURE_AXES];
+        memcpy(&counts[0], data.accel, sizeof(data.accel));
+        memcpy(&counts[3], data.gyro, sizeof(data.gyro));
+        fall_capture_push(&s_fall_capture, counts);
 
-        default:
-            state = ST_IDLE;
-            break;
+        // Log state changes
+        s_fall_state = s_fall_detector.state;
+        if (s_fall_detector.state != prev_state) {
+            ESP_LOGI(TAG, "State: %s -> %s (|acc|=%.2fg)",
+                     fall_detect_state_name(prev_state),
+                     fall_detect_state_name(s_fall_detector.state), fall_detect_acc_g(&s_fall_detector));
+            prev_state = s_fall_detector.state;
         }
 
-        // Log state changes
-        if (state != prev_state) {
-            ESP_LOGI(TAG, "State: %s -> %s",
-                     fall_state_to_str(prev_state),
-                     fall_state_to_str(state));
-            prev_state = state;
+        if (fall) {
+            float roll, pitch;
+            imu_fusion_angles(&s_fall_detector.fusion, &roll, &pitch);
+
+            ESP_LOGW(TAG, "[FALL DETECTED!] by the %s, |acc|=%.2fg, |gyro|=%.0fdps, "
+                     "roll=%.1f°, pitch=%.1f°, tilt=%.0f°",
+                     s_fall_detector.source == FALL_SOURCE_CLASSIFIER ? "classifier" : "state machine",
+                     fall_detect_acc_g(&s_fall_detector), fall_detect_gyro_dps(&s_fall_detector), roll, pitch,
+                     imu_fusion_tilt(&s_fall_detector.fusion, fall_detect_config()->upright_axis));
+            if (s_fall_detector.source == FALL_SOURCE_CLASSIFIER) {
+                ESP_LOGI(TAG, "Window: SMA %ld mg, jerk %ld mg/s, std %ld mg, peak %ld mg, turned %ld°",
+                         (long)s_fall_detector.feat[FALL_FEAT_SMA], (long)s_fall_detector.feat[FALL_FEAT_JERK],
+                         (long)s_fall_detector.feat[FALL_FEAT_STD], (long)s_fall_detector.feat[FALL_FEAT_PEAK],
+                         (long)s_fall_detector.feat[FALL_FEAT_ORIENT]);
+            }
+
+            // Trigger fall alarm; the waveform follows once the post-trigger window is in
+            alarm_fall_detection();
+            if (fall_capture_trigger(&s_fall_capture, esp_timer_get_time())) {
+                s_fall_capture_source = s_fall_detector.source;
+            } else {
+                ESP_LOGW(TAG, "Previous fall capture not sent yet, this one is not recorded");
+            }
         }
     }
 }
@@ -486,7 +872,7 @@ static esp_err_t system_init(void) {
     
     // Create FreeRTOS queues
     s_oled_queue = xQueueCreate(16, sizeof(display_data_t));
-    g_mpu_queue = xQueueCreate(QUEUE_LEN, sizeof(mpu6050_data_t));
+    g_mpu_queue = xQueueCreate(QUEUE_LEN, sizeof(mpu6050_raw_t));
 
     // Initialize MPU6050 sensor
     ESP_ERROR_CHECK(mpu6050_init(I2C_PORT));
@@ -527,18 +913,42 @@ static void start_sensor_tasks(void) {
         ESP_LOGW(TAG, "Temperature sensor init failed");
     }
 
-    // Initialize and start heart rate sensor
+    // Initialize and start heart rate sensor (per-unit rate from NVS)
+    uint16_t ppg_rate_hz;
+    if (nvs_load_ppg_sample_rate(&ppg_rate_hz)) {
+        s_ppg_rate_hz = ppg_rate_hz;
+        heart_rate_set_sample_rate(ppg_rate_hz);
+    }
+    mqtt_register_attribute(PPG_RATE_ATTR, on_ppg_rate_attribute);
+    // SpO2 curve of this unit's sensor lot, updated over MQTT
+    ppg_calib_table_t calib;
+    if (nvs_load_spo2_calib(&calib, sizeof(calib)) && !ppg_calib_set(&calib)) {
+        ESP_LOGW(TAG, "Stored SpO2 calibration invalid, using the default curve");
+    }
+    mqtt_register_attribute(SPO2_CALIB_ATTR, on_spo2_calib_attribute);
     if (heart_rate_sensor_init() == ESP_OK) {
         heart_rate_start_task(on_heart_rate_update);
     } else {
         ESP_LOGW(TAG, "Heart rate sensor init failed");
     }
 
+    // Fall thresholds of this unit, tuned over MQTT
+    fall_detect_config_t fall_cfg;
+    if (nvs_load_fall_config(&fall_cfg, sizeof(fall_cfg)) && !fall_detect_set_config(&fall_cfg)) {
+        ESP_LOGW(TAG, "Stored fall thresholds invalid, using the defaults");
+    }
+    fall_model_t fall_model;
+    if (nvs_load_fall_model(&fall_model, sizeof(fall_model)) && !fall_model_set(&fall_model)) {
+        ESP_LOGW(TAG, "Stored fall classifier tree invalid, using the built-in one");
+    }
+    mqtt_register_attribute(FALL_CONFIG_ATTR, on_fall_config_attribute);
+    mqtt_register_attribute(FALL_MODEL_ATTR, on_fall_model_attribute);
+
     // Start display and MPU6050 tasks
-    xTaskCreate(oled_display_task, "oled_task", 4096, (void *)s_oled_queue, 3, NULL);
-    xTaskCreate(oled_update_task, "oled_update", 2048, NULL, 3, NULL);
-    xTaskCreate(mpu6050_task, "mpu6050_task", 4096, NULL, 5, NULL);
-    xTaskCreate(handle_mpu6050_data, "fall_detect", 4096, NULL, 4, NULL);
+    task_map_create(TASK_OLED, oled_display_task, (void *)s_oled_queue, NULL);
+    task_map_create(TASK_OLED_UPDATE, oled_update_task, NULL, NULL);
+    task_map_create(TASK_MPU, mpu6050_task, NULL, NULL);
+    task_map_create(TASK_FALL, handle_mpu6050_data, NULL, NULL);
 }
 
 /**
@@ -590,7 +1000,7 @@ static esp_err_t start_normal_mode(void) {
         // Initialize MQTT
         esp_err_t err = mqtt_client_init(token);
         if (err == ESP_OK) {
-            xTaskCreate(mqtt_send_task, "mqtt_send", 4096, NULL, 5, NULL);
+            task_map_create(TASK_MQTT_SEND, mqtt_send_task, NULL, NULL);
             mqtt_start_ota_scheduler();
         } else {
             ESP_LOGW(TAG, "MQTT init failed");
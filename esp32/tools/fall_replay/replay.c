@@ -0,0 +1,617 @@
+/*
+ * Host replay of IMU traces through the fall detection component.
+ *
+ *   fall_replay trace.csv [options]
+ *   fall_replay --synth falls|slumps|adl [options]
+ *
+ * The CSV holds one MPU6050 sample per line: "t_ms,ax,ay,az,gx,gy,gz[,fall]"
+ * with acceleration in g and angular rate in deg/s. Samples are turned into
+ * the sensor's int16 counts (±2 g, ±500 deg/s ranges) before the detector,
+ * as mpu6050_read_fifo_raw() delivers them on the device.
+ * Lines that do not start with a digit (headers, comments) are skipped.
+ * The optional last column marks the samples of a labelled fall (non-zero
+ * from the loss of balance to the wearer lying still); each run of marked
+ * samples is one fall episode.
+ *
+ * A detection inside an episode, or up to --match-ms after its end, is a
+ * hit; any other detection is a false positive. Detections are counted per
+ * path (state machine, classifier). The time per sample covers
+ * fall_detect_process() only (orientation filter, feature window, state
+ * machine and classifier).
+ *
+ * Every detection also triggers the raw sample capture of fall_capture.h,
+ * as the firmware does: once the post-trigger window is in, the capture is
+ * encoded, decoded back and compared with the trace, and its size is
+ * reported. A capture that does not round-trip fails the run.
+ *
+ * --features writes every classifier evaluation as a CSV row
+ * "t_ms,sma,jerk,std,peak,orient,tilt,class,fall" (class = the tree's
+ * verdict, fall = inside an episode or its match window), the training
+ * set of a fall_model_t.
+ *
+ * Options:
+ *   --ff-g X             Free-fall threshold (g)
+ *   --ff-min-ms N        Minimum free-fall duration
+ *   --ff-max-ms N        Maximum free-fall before impact
+ *   --impact-g X         Impact threshold (g)
+ *   --impact-timeout-ms N
+ *   --inact-dps X        Post-impact gyro inactivity threshold
+ *   --lying-deg X        Tilt of the upright axis counted as lying
+ *   --axis N             Upright axis (0 = X, 1 = Y, 2 = Z)
+ *   --post-window-ms N   Post-impact monitoring window
+ *   --cooldown-ms N      Minimum time between two reports
+ *   --match-ms N         Detection delay still counted as a hit (default 3000)
+ *   --model F:T:B:A,..   Decision tree, one node per item: feature index
+ *                        (fall_feature_t), threshold, node below, node at or
+ *                        above; "-1:C" is a leaf of class C. Node 0 is the root.
+ *   --no-classifier      State machine only
+ *   --features FILE      Write the classifier evaluations to FILE
+ *   --synth S            Replay a synthetic trace: falls | slumps | adl
+ *   --episodes N         Episodes of the synthetic trace (default 10)
+ *   --gate-recall X      Exit 1 if fewer than X % of the falls are detected
+ *   --gate-fp N          Exit 1 on more than N false positives
+ *   --verbose            One line per state change and detection
+ *
+ * Thresholds not given keep the firmware defaults (FALL_* in fall_detect.h),
+ * the classifier keeps the built-in fall_model_t.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fall_detect.h"
+#include "fall_capture.h"
+
+#define RATE_HZ 100         // As MPU6050_SAMPLE_RATE_HZ
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+	float t_ms;
+	float a[3];             // g
+	float g[3];             // deg/s
+	bool fall;              // Inside a labelled fall
+} sample_t;
+
+typedef struct {
+	sample_t *s;
+	size_t len;
+	size_t cap;
+} trace_t;
+
+typedef enum {
+	SYNTH_NONE = 0,
+	SYNTH_FALLS,
+	SYNTH_SLUMPS,
+	SYNTH_ADL,
+} synth_t;
+
+typedef struct {
+	fall_detect_config_t cfg;
+	fall_model_t model;
+	const char *features;
+	float match_ms;
+	synth_t synth;
+	int episodes;
+	float gate_recall;
+	float gate_fp;
+	bool verbose;
+} options_t;
+
+/*
+ * Synthetic wearer: orientation is one rotation angle about a sensor axis
+ * (the upright axis stays X), so gravity and the gyro stay consistent.
+ */
+typedef struct {
+	trace_t *t;
+	float t_ms;
+	float theta;            // Rotation from upright (rad)
+	int axis;               // 1 = Y (onto the back), 2 = Z (onto the side)
+	bool fall;
+} synth_state_t;
+
+
+static double now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static int16_t to_counts(float v, float lsb_per_unit)
+{
+	float x = roundf(v * lsb_per_unit);
+	return (int16_t)fmaxf(-32768.0f, fminf(32767.0f, x));
+}
+
+
+// A sample as the sensor's int16 counts, what the firmware reads
+static void sample_counts(const sample_t *s, int16_t out[FALL_CAPTURE_AXES])
+{
+	for (int k = 0; k < 3; k++) {
+		out[k] = to_counts(s->a[k], FALL_ACC_LSB_PER_G);
+		out[3 + k] = to_counts(s->g[k], FALL_GYRO_LSB_PER_DPS);
+	}
+}
+
+
+// Decode a frozen capture and compare it with the trace (released as soon as frozen, so sample number = index)
+static bool capture_round_trip(const fall_capture_t *cap, const trace_t *t, size_t *text_len)
+{
+	static char text[FALL_CAPTURE_TEXT_MAX];
+	static int16_t decoded[FALL_CAPTURE_LEN][FALL_CAPTURE_AXES];
+	uint32_t pre;
+	uint32_t count = fall_capture_count(cap, &pre);
+
+	*text_len = fall_capture_encode(cap, text, sizeof(text));
+	if (*text_len == 0 || fall_capture_decode(text, decoded, FALL_CAPTURE_LEN) != count) {
+		return false;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		int16_t expected[FALL_CAPTURE_AXES];
+		sample_counts(&t->s[cap->first + i], expected);
+		if (memcmp(decoded[i], expected, sizeof(expected)) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static void trace_append(trace_t *t, const sample_t *s)
+{
+	if (t->len == t->cap) {
+		t->cap = t->cap ? t->cap * 2 : 4096;
+		t->s = realloc(t->s, t->cap * sizeof(*t->s));
+		if (!t->s) {
+			fprintf(stderr, "out of memory\n");
+			exit(2);
+		}
+	}
+	t->s[t->len++] = *s;
+}
+
+
+static bool trace_load_csv(trace_t *t, const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return false;
+	}
+
+	char line[256];
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] < '0' || line[0] > '9') {
+			continue;
+		}
+		sample_t s = {0};
+		int label = 0;
+		int fields = sscanf(line, "%f,%f,%f,%f,%f,%f,%f,%d", &s.t_ms, &s.a[0], &s.a[1], &s.a[2],
+		                    &s.g[0], &s.g[1], &s.g[2], &label);
+		if (fields < 7) {
+			continue;
+		}
+		s.fall = (label != 0);
+		trace_append(t, &s);
+	}
+	fclose(f);
+	return t->len > 0;
+}
+
+
+static float noise(float amplitude)
+{
+	return amplitude * ((rand() % 2001) - 1000) / 1000.0f;
+}
+
+
+/*
+ * Emit ms of samples: the specific force is gravity scaled by g_scale
+ * (0 in free fall, above 1 at an impact) plus bob along the vertical,
+ * while the body turns at rate_dps about the synth axis.
+ */
+static void synth_phase(synth_state_t *st, float ms, float g_scale, float rate_dps,
+                        float bob_g, float bob_hz)
+{
+	int n = (int)(ms * RATE_HZ / 1000.0f + 0.5f);
+	for (int i = 0; i < n; i++) {
+		float c = cosf(st->theta), s = sinf(st->theta);
+		float bob = bob_g * sinf(2 * (float)M_PI * bob_hz * st->t_ms / 1000.0f);
+		float f = g_scale + bob;
+		sample_t smp = {.t_ms = st->t_ms, .fall = st->fall};
+
+		// World up in the sensor frame after turning theta about Y or Z
+		smp.a[0] = f * c + noise(0.02f);
+		smp.a[1] = (st->axis == 2 ? -f * s : 0) + noise(0.02f);
+		smp.a[2] = (st->axis == 1 ? f * s : 0) + noise(0.02f);
+		smp.g[0] = noise(1.5f);
+		smp.g[1] = (st->axis == 1 ? rate_dps : 0) + (bob_g > 0 ? 20 * bob / bob_g : 0) + noise(1.5f);
+		smp.g[2] = (st->axis == 2 ? rate_dps : 0) + noise(1.5f);
+		trace_append(st->t, &smp);
+
+		st->theta += rate_dps * (float)M_PI / 180.0f / RATE_HZ;
+		st->t_ms += 1000.0f / RATE_HZ;
+	}
+}
+
+
+static float uniform(float lo, float hi)
+{
+	return lo + (hi - lo) * (rand() % 1001) / 1000.0f;
+}
+
+
+/*
+ * Falls: a stumble, 250-500 ms near free fall turning most of the way
+ * over, a 2-4 g impact finishing the turn, then lying still; the wearer
+ * gets up slowly and walks before the next one.
+ */
+static void synth_fall(synth_state_t *st)
+{
+	float ff_ms = uniform(250, 500);
+	float turn_deg = uniform(75, 100);
+	float impact_ms = 60;
+
+	st->axis = 1 + rand() % 2;
+	synth_phase(st, 3000, 1.0f, 0, 0.25f, 1.8f);
+
+	st->fall = true;
+	synth_phase(st, 300, 1.0f, 40, 0.3f, 3.0f);
+	float turned = 40 * 0.3f;
+	synth_phase(st, ff_ms, uniform(0.05f, 0.25f), (turn_deg * 0.8f - turned) * 1000 / ff_ms, 0, 0);
+	synth_phase(st, impact_ms, uniform(2.0f, 4.0f), turn_deg * 0.2f * 1000 / impact_ms, 0, 0);
+	synth_phase(st, 1000, 1.0f, 0, 0, 0);
+	st->fall = false;
+
+	synth_phase(st, 4000, 1.0f, 0, 0, 0);
+	float back_deg = st->theta * 180 / (float)M_PI;
+	synth_phase(st, 2500, 1.0f, -back_deg / 2.5f, 0.05f, 1.0f);
+	st->theta = 0;
+}
+
+
+/*
+ * Falls without free fall: seated, the wearer slides or topples out of the
+ * chair over about a second with |a| staying near 1 g, and hits the floor
+ * with a 1.4-2 g jolt, below what a drop gives.
+ */
+static void synth_slump(synth_state_t *st)
+{
+	float slump_ms = uniform(700, 1200);
+	float turn_deg = uniform(70, 95);
+
+	st->axis = 1 + rand() % 2;
+	st->theta = 10 * (float)M_PI / 180.0f;
+	synth_phase(st, 3000, 1.0f, 0, 0.02f, 0.3f);
+
+	st->fall = true;
+	synth_phase(st, slump_ms, uniform(0.8f, 0.95f), (turn_deg - 10) * 0.9f * 1000 / slump_ms, 0.1f, 2.0f);
+	synth_phase(st, 80, uniform(1.4f, 2.0f), (turn_deg - 10) * 0.1f * 1000 / 80, 0, 0);
+	synth_phase(st, 1000, 1.0f, 0, 0, 0);
+	st->fall = false;
+
+	synth_phase(st, 4000, 1.0f, 0, 0, 0);
+	float back_deg = st->theta * 180 / (float)M_PI;
+	synth_phase(st, 2500, 1.0f, -back_deg / 2.5f, 0.05f, 1.0f);
+	st->theta = 0;
+}
+
+
+/*
+ * Activities of daily living that come close: walking, a jump (real free
+ * fall and landing, upright after), a hard sit (short drop and jolt, then
+ * still but upright), lying down on purpose (no free fall, no jolt) and
+ * bending over to pick something up (tilted and still for a while).
+ */
+static void synth_adl(synth_state_t *st, int kind)
+{
+	st->axis = 1 + rand() % 2;
+	switch (kind % 5) {
+	case 0:
+		synth_phase(st, 10000, 1.0f, 0, 0.3f, uniform(1.6f, 2.2f));
+		break;
+	case 1:
+		synth_phase(st, 2000, 1.0f, 0, 0.25f, 1.8f);
+		synth_phase(st, 200, 1.8f, 0, 0, 0);
+		synth_phase(st, uniform(250, 350), 0.05f, 0, 0, 0);
+		synth_phase(st, 60, uniform(2.5f, 3.5f), 0, 0, 0);
+		synth_phase(st, 3000, 1.0f, 0, 0.25f, 1.8f);
+		break;
+	case 2:
+		synth_phase(st, 2000, 1.0f, 0, 0.25f, 1.8f);
+		synth_phase(st, uniform(150, 250), 0.25f, 60, 0, 0);
+		synth_phase(st, 80, uniform(1.6f, 2.2f), 40, 0, 0);
+		synth_phase(st, 4000, 1.0f, 0, 0, 0);
+		synth_phase(st, 1000, 1.0f, -st->theta * 180 / (float)M_PI, 0.05f, 1.0f);
+		st->theta = 0;
+		break;
+	case 3:
+		synth_phase(st, 2000, 1.0f, 0, 0.25f, 1.8f);
+		synth_phase(st, 1000, 1.0f, uniform(60, 80), 0.05f, 1.0f);
+		synth_phase(st, 2000, 1.0f, 0, 0, 0);
+		synth_phase(st, 1000, 1.0f, -st->theta * 180 / (float)M_PI, 0.05f, 1.0f);
+		st->theta = 0;
+		break;
+	default:
+		synth_phase(st, 2000, 1.0f, 0, 0.25f, 1.8f);
+		synth_phase(st, 2500, 1.0f, 36, 0.03f, 1.0f);
+		synth_phase(st, 5000, 1.0f, 0, 0, 0);
+		synth_phase(st, 2500, 1.0f, -36, 0.03f, 1.0f);
+		st->theta = 0;
+		break;
+	}
+}
+
+
+static void trace_synth(trace_t *t, const options_t *o)
+{
+	synth_state_t st = {.t = t, .t_ms = 1000};
+
+	srand(1);
+	for (int i = 0; i < o->episodes; i++) {
+		if (o->synth == SYNTH_FALLS) {
+			synth_fall(&st);
+		} else if (o->synth == SYNTH_SLUMPS) {
+			synth_slump(&st);
+		} else {
+			synth_adl(&st, i);
+		}
+	}
+	synth_phase(&st, 3000, 1.0f, 0, 0, 0);
+}
+
+
+// "F:T:B:A,..." per node, "-1:C" for a leaf of class C
+static bool parse_model(fall_model_t *m, const char *arg)
+{
+	memset(m->node, 0, sizeof(m->node));
+	m->count = 0;
+	while (*arg && m->count < FALL_MODEL_MAX_NODES) {
+		fall_node_t *n = &m->node[m->count++];
+		int feature, below = 0, above = 0, used = 0;
+		long threshold;
+		if (sscanf(arg, "%d:%ld%n:%d:%d%n", &feature, &threshold, &used, &below, &above, &used) < 2) {
+			return false;
+		}
+		n->feature = (feature < 0) ? FALL_MODEL_LEAF : (uint8_t)feature;
+		n->threshold = (int32_t)threshold;
+		n->below = (uint8_t)below;
+		n->above = (uint8_t)above;
+		arg += used;
+		arg += (*arg == ',');
+	}
+	m->enabled = 1;
+	return *arg == '\0';
+}
+
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: fall_replay (trace.csv | --synth falls|slumps|adl) [--episodes N]\n"
+	                "                   [--ff-g X] [--ff-min-ms N] [--ff-max-ms N]\n"
+	                "                   [--impact-g X] [--impact-timeout-ms N]\n"
+	                "                   [--inact-dps X] [--lying-deg X] [--axis N]\n"
+	                "                   [--post-window-ms N] [--cooldown-ms N] [--match-ms N]\n"
+	                "                   [--model F:T:B:A,..] [--no-classifier] [--features FILE]\n"
+	                "                   [--gate-recall X] [--gate-fp N] [--verbose]\n");
+	exit(2);
+}
+
+
+int main(int argc, char **argv)
+{
+	options_t o = {.match_ms = 3000, .episodes = 10, .gate_recall = NAN, .gate_fp = NAN};
+	fall_detect_default_config(&o.cfg);
+	fall_model_default(&o.model);
+	const char *path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		const char *a = argv[i];
+		bool has_value = (i + 1 < argc);
+		if (!strcmp(a, "--verbose")) o.verbose = true;
+		else if (!strcmp(a, "--ff-g") && has_value) o.cfg.ff_g = atof(argv[++i]);
+		else if (!strcmp(a, "--ff-min-ms") && has_value) o.cfg.ff_min_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "--ff-max-ms") && has_value) o.cfg.ff_max_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "--impact-g") && has_value) o.cfg.impact_g = atof(argv[++i]);
+		else if (!strcmp(a, "--impact-timeout-ms") && has_value) o.cfg.impact_timeout_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "--inact-dps") && has_value) o.cfg.post_inact_dps = atof(argv[++i]);
+		else if (!strcmp(a, "--lying-deg") && has_value) o.cfg.post_angle_deg = atof(argv[++i]);
+		else if (!strcmp(a, "--axis") && has_value) o.cfg.upright_axis = atoi(argv[++i]);
+		else if (!strcmp(a, "--post-window-ms") && has_value) o.cfg.post_window_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "--cooldown-ms") && has_value) o.cfg.cooldown_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "--match-ms") && has_value) o.match_ms = atof(argv[++i]);
+		else if (!strcmp(a, "--episodes") && has_value) o.episodes = atoi(argv[++i]);
+		else if (!strcmp(a, "--gate-recall") && has_value) o.gate_recall = atof(argv[++i]);
+		else if (!strcmp(a, "--gate-fp") && has_value) o.gate_fp = atof(argv[++i]);
+		else if (!strcmp(a, "--no-classifier")) o.model.enabled = 0;
+		else if (!strcmp(a, "--features") && has_value) o.features = argv[++i];
+		else if (!strcmp(a, "--model") && has_value) {
+			if (!parse_model(&o.model, argv[++i])) usage();
+		}
+		else if (!strcmp(a, "--synth") && has_value) {
+			const char *s = argv[++i];
+			if (!strcmp(s, "falls")) o.synth = SYNTH_FALLS;
+			else if (!strcmp(s, "slumps")) o.synth = SYNTH_SLUMPS;
+			else if (!strcmp(s, "adl")) o.synth = SYNTH_ADL;
+			else usage();
+		}
+		else if (a[0] != '-' && !path) path = a;
+		else usage();
+	}
+	if ((!path == (o.synth == SYNTH_NONE)) || o.episodes <= 0) {
+		usage();
+	}
+	if (!fall_detect_set_config(&o.cfg)) {
+		fprintf(stderr, "thresholds rejected by fall_detect_validate()\n");
+		return 2;
+	}
+	if (!fall_model_set(&o.model)) {
+		fprintf(stderr, "model rejected by fall_model_validate()\n");
+		return 2;
+	}
+	FILE *features = NULL;
+	if (o.features) {
+		features = fopen(o.features, "w");
+		if (!features) {
+			perror(o.features);
+			return 2;
+		}
+		fprintf(features, "t_ms,sma,jerk,std,peak,orient,tilt,class,fall\n");
+	}
+
+	trace_t t = {0};
+	if (path) {
+		if (!trace_load_csv(&t, path)) {
+			fprintf(stderr, "%s: no samples\n", path);
+			return 2;
+		}
+	} else {
+		trace_synth(&t, &o);
+	}
+
+	const fall_detect_config_t *c = fall_detect_config();
+	double hours = (t.s[t.len - 1].t_ms - t.s[0].t_ms) / 3.6e6;
+	printf("%s: %zu samples, %.1f min\n", path ? path : "synthetic", t.len, hours * 60);
+	printf("config: FF < %.2f g for %u..%u ms, impact > %.2f g within %u ms, "
+	       "still < %.0f dps and tilt > %.0f deg (axis %u) within %u ms, cooldown %u ms\n",
+	       c->ff_g, c->ff_min_ms, c->ff_max_ms, c->impact_g, c->impact_timeout_ms,
+	       c->post_inact_dps, c->post_angle_deg, c->upright_axis, c->post_window_ms, c->cooldown_ms);
+
+	static fall_detect_t d;
+	static fall_capture_t cap;
+	fall_detect_init(&d);
+	fall_capture_init(&cap);
+	uint32_t captures = 0, capture_errors = 0;
+	size_t capture_bytes = 0, capture_samples = 0;
+
+	uint32_t episodes = 0, hits = 0, false_pos = 0, detections = 0, by_source[2] = {0};
+	bool in_episode = false, episode_hit = false;
+	float episode_end = -INFINITY;
+	double time_sum_us = 0, time_max_us = 0;
+
+	for (size_t i = 0; i < t.len; i++) {
+		const sample_t *s = &t.s[i];
+		fall_state_t before = d.state;
+
+		if (s->fall && !in_episode) {
+			episodes++;
+			episode_hit = false;
+		}
+		if (!s->fall && in_episode) {
+			episode_end = s->t_ms;
+		}
+		in_episode = s->fall;
+
+		int16_t counts[FALL_CAPTURE_AXES];
+		sample_counts(s, counts);
+
+		double t0 = now_us();
+		bool fall = fall_detect_process(&d, (int64_t)(s->t_ms * 1000.0f), &counts[0], &counts[3]);
+		double elapsed = now_us() - t0;
+		time_sum_us += elapsed;
+		if (elapsed > time_max_us) {
+			time_max_us = elapsed;
+		}
+
+		fall_capture_push(&cap, counts);
+		if (fall) {
+			fall_capture_trigger(&cap, (int64_t)(s->t_ms * 1000.0f));
+		}
+		if (fall_capture_frozen(&cap)) {
+			uint32_t pre;
+			size_t len;
+			captures++;
+			capture_samples += fall_capture_count(&cap, &pre);
+			if (capture_round_trip(&cap, &t, &len)) {
+				capture_bytes += len;
+			} else {
+				capture_errors++;
+			}
+			fall_capture_release(&cap);
+		}
+
+		bool near_episode = in_episode || (episodes && s->t_ms - episode_end <= o.match_ms);
+		if (features && d.scored) {
+			fprintf(features, "%.0f", s->t_ms);
+			for (int k = 0; k < FALL_FEAT_COUNT; k++) {
+				fprintf(features, ",%d", (int)d.feat[k]);
+			}
+			fprintf(features, ",%d,%d\n", d.verdict, near_episode);
+		}
+
+		if (o.verbose && d.state != before) {
+			printf("%10.2f s  %s -> %s  |acc| %.2f g  |gyro| %.0f dps  tilt %.0f deg\n", s->t_ms / 1000,
+			       fall_detect_state_name(before), fall_detect_state_name(d.state), fall_detect_acc_g(&d),
+			       fall_detect_gyro_dps(&d), imu_fusion_tilt(&d.fusion, c->upright_axis));
+		}
+		if (!fall) {
+			continue;
+		}
+
+		detections++;
+		by_source[d.source]++;
+		bool hit = near_episode;
+		if (hit && !episode_hit) {
+			hits++;
+			episode_hit = true;
+		} else if (!hit) {
+			false_pos++;
+		}
+		if (o.verbose) {
+			printf("%10.2f s  FALL by the %s%s\n", s->t_ms / 1000,
+			       d.source == FALL_SOURCE_CLASSIFIER ? "classifier" : "state machine",
+			       hit ? "" : "  (false positive)");
+			if (d.source == FALL_SOURCE_CLASSIFIER) {
+				printf("            SMA %d mg, jerk %d mg/s, std %d mg, peak %d mg, orientation %d deg, "
+				       "tilt %d deg\n", (int)d.feat[FALL_FEAT_SMA], (int)d.feat[FALL_FEAT_JERK],
+				       (int)d.feat[FALL_FEAT_STD], (int)d.feat[FALL_FEAT_PEAK], (int)d.feat[FALL_FEAT_ORIENT],
+				       (int)d.feat[FALL_FEAT_TILT]);
+			}
+		}
+	}
+
+	double recall = episodes ? 100.0 * hits / episodes : NAN;
+	printf("detections: %u (state machine %u, classifier %u%s)\n", detections,
+	       by_source[FALL_SOURCE_STATE_MACHINE], by_source[FALL_SOURCE_CLASSIFIER],
+	       o.model.enabled ? "" : " off");
+	if (episodes) {
+		printf("falls: %u of %u detected (%.0f %%)\n", hits, episodes, recall);
+	}
+	printf("false positives: %u (%.1f per hour)\n", false_pos, hours > 0 ? false_pos / hours : 0);
+	if (captures) {
+		printf("captures: %u, %.0f samples and %.0f base64 chars each (%.2f bytes/sample, raw 12), %u failed round trip\n",
+		       captures, (double)capture_samples / captures, (double)capture_bytes / captures,
+		       capture_samples ? capture_bytes * 0.75 / capture_samples : 0, capture_errors);
+	}
+	printf("time: %.3f us/sample mean, %.1f us max (orientation filter, features, state machine, classifier)\n",
+	       time_sum_us / t.len, time_max_us);
+
+	// Gates: a recall gate without labelled falls fails too, it proves nothing
+	int status = 0;
+	if (!isnan(o.gate_recall) && !(recall >= o.gate_recall)) {
+		printf("FAIL: recall below %.0f %%\n", o.gate_recall);
+		status = 1;
+	}
+	if (!isnan(o.gate_fp) && !(false_pos <= o.gate_fp)) {
+		printf("FAIL: more than %.0f false positives\n", o.gate_fp);
+		status = 1;
+	}
+
+	if (capture_errors) {
+		printf("FAIL: %u captures did not decode to the trace\n", capture_errors);
+		status = 1;
+	}
+
+	if (features) {
+		fclose(features);
+	}
+	free(t.s);
+	return status;
+}
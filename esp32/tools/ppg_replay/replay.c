@@ -0,0 +1,580 @@
+/*
+ * Host replay of red/IR traces through the MAX30102 algorithm library.
+ *
+ *   ppg_replay trace.csv [options]
+ *   ppg_replay --synth BPM [options]
+ *
+ * The CSV holds one FIFO sample per line: "red,ir[,ref_bpm[,ref_spo2]]".
+ * Lines that do not start with a digit (headers, comments) are skipped.
+ * Per-line references come from a reference device recorded alongside;
+ * --ref-bpm / --ref-spo2 set a constant one instead.
+ *
+ * Each window runs the same chain as heart_rate_read(): by default the
+ * block path (remove_dc_part -> remove_trend_line -> quality gate ->
+ * estimator -> spo2_measurement), with --stream the per-sample
+ * ppg_filter path. Accuracy is scored against the reference at the last
+ * sample of the window; the time per window covers the processing only.
+ * The stream path also reports the ppg_quality_confidence() of each
+ * window, which needs the beat detector the block path does not run.
+ *
+ * Options:
+ *   --rate HZ          Effective sample rate (default 50)
+ *   --window N         Window length, 0 = automatic (default 0)
+ *   --hop N            Samples between estimates (default 16)
+ *   --estimator E      autocorr | spectral | beats (beats implies --stream)
+ *   --stream           IIR band-pass per sample instead of block detrend
+ *   --ref-bpm X        Constant BPM reference
+ *   --ref-spo2 X       Constant SpO2 reference
+ *   --tol-bpm X        Tolerance for the "within" figure (default 5)
+ *   --gate-bpm X       Exit 1 if the BPM mean absolute error exceeds X
+ *   --gate-spo2 X      Exit 1 if the SpO2 mean absolute error exceeds X
+ *   --synth BPM        Replay a synthetic trace instead of a file
+ *   --synth-spo2 X     SpO2 of the synthetic trace (default 97)
+ *   --synth-resp X     Breaths per minute of the synthetic trace (default 15)
+ *   --ref-resp X       Constant respiratory-rate reference (stream path)
+ *   --gate-resp X      Exit 1 if the respiratory-rate mean absolute error exceeds X
+ *   --min-confidence X Confidence counted as low (default 50, as HEART_RATE_CONFIDENCE_MIN)
+ *   --gate-confidence X Exit 1 if the mean confidence is below X (stream path)
+ *   --seconds S        Length of the synthetic trace (default 60)
+ *   --calib R:S,...    SpO2 calibration table (R ascending) instead of the built-in line
+ *   --verbose          One line per window
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "algorithm.h"
+#include "ppg_beat.h"
+#include "ppg_calib.h"
+#include "ppg_filter.h"
+#include "ppg_quality.h"
+#include "ppg_resp.h"
+#include "ppg_window.h"
+
+#define RESP_UPDATE_S 5     // As HEART_RATE_RESP_UPDATE_S
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+	int32_t *red;
+	int32_t *ir;
+	float *ref_bpm;     // NAN where unknown
+	float *ref_spo2;
+	size_t len;
+	size_t cap;
+} trace_t;
+
+typedef struct {
+	double rate;
+	int window;
+	int hop;
+	hr_estimator_t estimator;
+	bool stream;
+	float ref_bpm;
+	float ref_spo2;
+	float tol_bpm;
+	float gate_bpm;
+	float gate_spo2;
+	float synth_bpm;
+	float synth_spo2;
+	float synth_resp;
+	float ref_resp;
+	float gate_resp;
+	float min_confidence;
+	float gate_confidence;
+	float seconds;
+	bool verbose;
+} options_t;
+
+typedef struct {
+	uint32_t windows;
+	uint32_t rejected[PPG_QUALITY_NOISY + 1];
+	uint32_t bpm_scored;
+	uint32_t bpm_within;
+	double bpm_abs_err;
+	uint32_t spo2_scored;
+	double spo2_abs_err;
+	uint32_t resp_estimates;
+	uint32_t resp_due;          // Estimates with >= PPG_RESP_MIN_S of data
+	uint32_t resp_scored;
+	double resp_abs_err;
+	uint32_t conf_scored;
+	uint32_t conf_low;          // Below --min-confidence
+	double conf_sum;
+	double time_sum_us;
+	double time_max_us;
+} stats_t;
+
+
+static double now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static void trace_append(trace_t *t, int32_t red, int32_t ir, float ref_bpm, float ref_spo2)
+{
+	if (t->len == t->cap) {
+		t->cap = t->cap ? t->cap * 2 : 4096;
+		t->red = realloc(t->red, t->cap * sizeof(*t->red));
+		t->ir = realloc(t->ir, t->cap * sizeof(*t->ir));
+		t->ref_bpm = realloc(t->ref_bpm, t->cap * sizeof(*t->ref_bpm));
+		t->ref_spo2 = realloc(t->ref_spo2, t->cap * sizeof(*t->ref_spo2));
+		if (!t->red || !t->ir || !t->ref_bpm || !t->ref_spo2) {
+			fprintf(stderr, "out of memory\n");
+			exit(2);
+		}
+	}
+	t->red[t->len] = red;
+	t->ir[t->len] = ir;
+	t->ref_bpm[t->len] = ref_bpm;
+	t->ref_spo2[t->len] = ref_spo2;
+	t->len++;
+}
+
+
+static bool trace_load_csv(trace_t *t, const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return false;
+	}
+
+	char line[256];
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] < '0' || line[0] > '9') {
+			continue;
+		}
+		long red, ir;
+		float bpm = NAN, spo2 = NAN;
+		int fields = sscanf(line, "%ld,%ld,%f,%f", &red, &ir, &bpm, &spo2);
+		if (fields < 2) {
+			continue;
+		}
+		trace_append(t, (int32_t)red, (int32_t)ir, bpm, spo2);
+	}
+	fclose(f);
+	return t->len > 0;
+}
+
+
+/*
+ * Ratio of ratios the active table maps to an SpO2: the first segment
+ * that brackets it, interpolated back; outside the table, the end point
+ * with the closer SpO2.
+ */
+static double calib_ratio(double spo2)
+{
+	const ppg_calib_table_t *c = ppg_calib_get();
+
+	for (int i = 1; i < c->count; i++) {
+		double s0 = c->spo2[i - 1], s1 = c->spo2[i];
+		if ((spo2 - s0) * (spo2 - s1) <= 0 && s0 != s1) {
+			return c->r[i - 1] + (spo2 - s0) / (s1 - s0) * (c->r[i] - c->r[i - 1]);
+		}
+	}
+	int last = c->count - 1;
+	return (fabs(spo2 - c->spo2[0]) <= fabs(spo2 - c->spo2[last])) ? c->r[0] : c->r[last];
+}
+
+
+/*
+ * "R:SpO2,R:SpO2,..." as a calibration table of lot "replay"
+ */
+static bool calib_parse(const char *spec, ppg_calib_table_t *c)
+{
+	memset(c, 0, sizeof(*c));
+	c->version = PPG_CALIB_VERSION;
+	strcpy(c->lot, "replay");
+
+	const char *p = spec;
+	while (*p) {
+		char *end;
+		if (c->count == PPG_CALIB_MAX_POINTS) {
+			return false;
+		}
+		c->r[c->count] = strtof(p, &end);
+		if (end == p || *end != ':') {
+			return false;
+		}
+		p = end + 1;
+		c->spo2[c->count] = strtof(p, &end);
+		if (end == p || (*end != ',' && *end != '\0')) {
+			return false;
+		}
+		c->count++;
+		p = (*end == ',') ? end + 1 : end;
+	}
+	return ppg_calib_validate(c);
+}
+
+
+/*
+ * Systolic wave plus dicrotic notch, +-2 % beat-to-beat variation and ADC
+ * noise. Breathing modulates the baseline, the pulse amplitude (+-10 %)
+ * and the interval (+-4 %, sinus arrhythmia); a slower drift comes on
+ * top. The red AC is scaled so that the ratio of ratios gives the
+ * requested SpO2 through the active calibration table.
+ */
+static void trace_synth(trace_t *t, const options_t *o)
+{
+	const double ir_dc = 120000, red_dc = 90000, ir_ac = 800;
+	double z = calib_ratio(o->synth_spo2);
+	double red_ac = z * ir_ac / ir_dc * red_dc;
+	size_t n = (size_t)(o->seconds * o->rate);
+	double phase = 0, rr = 60.0 / o->synth_bpm;
+	double resp_hz = o->synth_resp / 60.0;
+
+	srand(1);
+	for (size_t i = 0; i < n; i++) {
+		double t_s = i / o->rate;
+		double breath = sin(2 * M_PI * resp_hz * t_s);
+		double pulse = exp(-pow((phase - 0.2) / 0.08, 2)) + 0.35 * exp(-pow((phase - 0.55) / 0.1, 2));
+		double wander = 120 * breath + 50 * sin(2 * M_PI * 0.05 * t_s + 1);
+		pulse *= 1.0 + 0.1 * breath;
+		double noise_ir = (rand() % 61) - 30;
+		double noise_red = (rand() % 61) - 30;
+
+		trace_append(t, (int32_t)(red_dc + red_ac * pulse + 0.75 * wander + noise_red),
+		             (int32_t)(ir_dc + ir_ac * pulse + wander + noise_ir),
+		             o->synth_bpm, o->synth_spo2);
+
+		phase += 1.0 / (o->rate * rr);
+		if (phase >= 1.0) {
+			phase -= 1.0;
+			rr = 60.0 / o->synth_bpm * (1.0 + 0.04 * breath + 0.02 * ((rand() % 201) - 100) / 100.0);
+		}
+	}
+}
+
+
+static void score_window(stats_t *s, const options_t *o, const trace_t *t, size_t last,
+                         int32_t *ir, int32_t *red, uint64_t ir_dc, uint64_t red_dc,
+                         const ppg_beat_t *beats, double t_start)
+{
+	static double auto_corr[BUFFER_SIZE];
+	double r0;
+	int bpm;
+
+	s->windows++;
+	ppg_quality_metrics_t metrics;
+	ppg_quality_t quality = ppg_quality_check(ir, red, ir_dc, red_dc, &metrics);
+	if (quality != PPG_QUALITY_GOOD) {
+		s->rejected[quality]++;
+		if (o->verbose) {
+			printf("%8.2f s  rejected: %s\n", last / o->rate, ppg_quality_name(quality));
+		}
+		return;
+	}
+
+	if (o->estimator == HR_ESTIMATOR_SPECTRAL) {
+		bpm = calculate_heart_rate_spectral(ir);
+	} else if (o->estimator == HR_ESTIMATOR_BEATS) {
+		bpm = ppg_beat_heart_rate(beats, (uint32_t)(algo_ctx.window_len * algo_ctx.sample_period * 1000));
+	} else {
+		bpm = calculate_heart_rate(ir, &r0, auto_corr);
+	}
+	double spo2 = spo2_measurement(ir, red, ir_dc, red_dc);
+
+	int confidence = -1;
+	if (beats) {
+		uint32_t span_ms = (uint32_t)(algo_ctx.window_len * algo_ctx.sample_period * 1000);
+		metrics.periodicity = ppg_quality_periodicity(ir, bpm);
+		confidence = ppg_quality_confidence(&metrics, bpm, ppg_beat_heart_rate(beats, span_ms),
+		                                    ppg_beat_count(beats, span_ms));
+	}
+
+	double elapsed = now_us() - t_start;
+	s->time_sum_us += elapsed;
+	if (elapsed > s->time_max_us) {
+		s->time_max_us = elapsed;
+	}
+
+	float ref_bpm = isnan(o->ref_bpm) ? t->ref_bpm[last] : o->ref_bpm;
+	float ref_spo2 = isnan(o->ref_spo2) ? t->ref_spo2[last] : o->ref_spo2;
+	if (!isnan(ref_bpm)) {
+		double err = fabs(bpm - ref_bpm);
+		s->bpm_scored++;
+		s->bpm_abs_err += err;
+		s->bpm_within += (err <= o->tol_bpm);
+	}
+	if (!isnan(ref_spo2)) {
+		s->spo2_scored++;
+		s->spo2_abs_err += fabs(spo2 - ref_spo2);
+	}
+	if (confidence >= 0) {
+		s->conf_scored++;
+		s->conf_sum += confidence;
+		s->conf_low += (confidence < o->min_confidence);
+	}
+
+	if (o->verbose) {
+		printf("%8.2f s  %3d BPM (ref %5.1f)  SpO2 %5.1f %% (ref %5.1f)  conf %3d  %6.1f us\n",
+		       last / o->rate, bpm, ref_bpm, spo2, ref_spo2, confidence, elapsed);
+	}
+}
+
+
+static void replay_block(const trace_t *t, const options_t *o, stats_t *s)
+{
+	static int32_t ir[BUFFER_SIZE], red[BUFFER_SIZE];
+	size_t n = algo_ctx.window_len;
+
+	for (size_t end = n; end <= t->len; end += o->hop) {
+		memcpy(ir, &t->ir[end - n], n * sizeof(int32_t));
+		memcpy(red, &t->red[end - n], n * sizeof(int32_t));
+
+		double t0 = now_us();
+		uint64_t ir_dc, red_dc;
+		remove_dc_part(ir, red, &ir_dc, &red_dc);
+		remove_trend_line(ir);
+		remove_trend_line(red);
+		score_window(s, o, t, end - 1, ir, red, ir_dc, red_dc, NULL, t0);
+	}
+}
+
+
+static void score_resp(stats_t *s, const options_t *o, size_t last, bool ok, const ppg_resp_result_t *rr)
+{
+	s->resp_estimates++;
+	if (o->verbose) {
+		printf("%8.2f s  resp %5.1f /min (BW %4.1f AM %4.1f FM %4.1f, %u s)%s\n", last / o->rate,
+		       rr->rate_brpm, rr->series_brpm[PPG_RESP_BW], rr->series_brpm[PPG_RESP_AM],
+		       rr->series_brpm[PPG_RESP_FM], rr->span_s, ok ? "" : "  no estimate");
+	}
+	// Coverage counts from the first span long enough to estimate at all
+	if (rr->span_s >= PPG_RESP_MIN_S) {
+		s->resp_due++;
+	}
+	if (ok && !isnan(o->ref_resp)) {
+		s->resp_scored++;
+		s->resp_abs_err += fabs(rr->rate_brpm - o->ref_resp);
+	}
+}
+
+
+static void replay_stream(const trace_t *t, const options_t *o, stats_t *s)
+{
+	static int32_t ir[BUFFER_SIZE], red[BUFFER_SIZE];
+	static ppg_window_t window;
+	static ppg_beat_t beats;
+	static ppg_resp_t resp;
+	ppg_filter_t f_ir, f_red;
+	size_t resp_every = (size_t)(RESP_UPDATE_S * algo_ctx.sample_rate);
+	double resp_us = 0;
+
+	ppg_window_init(&window, o->hop);
+	ppg_filter_init(&f_ir, (float)algo_ctx.sample_rate);
+	ppg_filter_init(&f_red, (float)algo_ctx.sample_rate);
+	ppg_beat_init(&beats, (float)algo_ctx.sample_rate);
+	ppg_resp_init(&resp, (float)algo_ctx.sample_rate);
+
+	double filter_us = 0;
+	for (size_t i = 0; i < t->len; i++) {
+		double t0 = now_us();
+		int32_t red_f, ir_f;
+		bool settled = ppg_filter_process(&f_red, t->red[i], &red_f);
+		settled &= ppg_filter_process(&f_ir, t->ir[i], &ir_f);
+		if (!settled) {
+			continue;
+		}
+		ppg_resp_sample(&resp, t->ir[i]);
+		uint32_t beats_before = beats.beats;
+		bool accepted = ppg_beat_process(&beats, ir_f);
+		if (beats.beats != beats_before) {
+			ppg_resp_beat(&resp, &beats, accepted);
+		}
+		bool due = ppg_window_push(&window, red_f, ir_f);
+		filter_us += now_us() - t0;
+
+		if (resp.n % resp_every == 0) {
+			ppg_resp_result_t rr;
+			t0 = now_us();
+			bool ok = ppg_resp_estimate(&resp, &rr);
+			resp_us += now_us() - t0;
+			score_resp(s, o, i, ok, &rr);
+		}
+
+		if (due) {
+			t0 = now_us();
+			ppg_window_copy(&window, ir, red);
+			score_window(s, o, t, i, ir, red, ppg_filter_dc(&f_ir), ppg_filter_dc(&f_red), &beats, t0);
+		}
+	}
+	printf("filter: %.2f us/sample (DC tracker, band-pass, beat detector, respiration series, window)\n",
+	       t->len ? filter_us / t->len : 0);
+	if (s->resp_estimates) {
+		printf("respiration: %.1f us/estimate every %d s\n", resp_us / s->resp_estimates, RESP_UPDATE_S);
+	}
+}
+
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: ppg_replay (trace.csv | --synth BPM) [--rate HZ] [--window N] [--hop N]\n"
+	                "                  [--estimator autocorr|spectral|beats] [--stream]\n"
+	                "                  [--ref-bpm X] [--ref-spo2 X] [--tol-bpm X]\n"
+	                "                  [--gate-bpm X] [--gate-spo2 X] [--synth-spo2 X] [--seconds S] [--verbose]\n"
+	                "                  [--synth-resp X] [--ref-resp X] [--gate-resp X]\n"
+	                "                  [--min-confidence X] [--gate-confidence X] [--calib R:S,...]\n");
+	exit(2);
+}
+
+
+int main(int argc, char **argv)
+{
+	options_t o = {
+		.rate = 50, .window = 0, .hop = 16, .estimator = HR_ESTIMATOR_AUTOCORRELATION,
+		.ref_bpm = NAN, .ref_spo2 = NAN, .tol_bpm = 5, .gate_bpm = NAN, .gate_spo2 = NAN,
+		.synth_bpm = NAN, .synth_spo2 = 97, .seconds = 60,
+		.synth_resp = 15, .ref_resp = NAN, .gate_resp = NAN,
+		.min_confidence = 50, .gate_confidence = NAN,
+	};
+	const char *path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		const char *a = argv[i];
+		bool has_value = (i + 1 < argc);
+		if (!strcmp(a, "--stream")) o.stream = true;
+		else if (!strcmp(a, "--verbose")) o.verbose = true;
+		else if (!strcmp(a, "--rate") && has_value) o.rate = atof(argv[++i]);
+		else if (!strcmp(a, "--window") && has_value) o.window = atoi(argv[++i]);
+		else if (!strcmp(a, "--hop") && has_value) o.hop = atoi(argv[++i]);
+		else if (!strcmp(a, "--ref-bpm") && has_value) o.ref_bpm = atof(argv[++i]);
+		else if (!strcmp(a, "--ref-spo2") && has_value) o.ref_spo2 = atof(argv[++i]);
+		else if (!strcmp(a, "--tol-bpm") && has_value) o.tol_bpm = atof(argv[++i]);
+		else if (!strcmp(a, "--gate-bpm") && has_value) o.gate_bpm = atof(argv[++i]);
+		else if (!strcmp(a, "--gate-spo2") && has_value) o.gate_spo2 = atof(argv[++i]);
+		else if (!strcmp(a, "--synth") && has_value) o.synth_bpm = atof(argv[++i]);
+		else if (!strcmp(a, "--synth-spo2") && has_value) o.synth_spo2 = atof(argv[++i]);
+		else if (!strcmp(a, "--synth-resp") && has_value) o.synth_resp = atof(argv[++i]);
+		else if (!strcmp(a, "--ref-resp") && has_value) o.ref_resp = atof(argv[++i]);
+		else if (!strcmp(a, "--gate-resp") && has_value) o.gate_resp = atof(argv[++i]);
+		else if (!strcmp(a, "--min-confidence") && has_value) o.min_confidence = atof(argv[++i]);
+		else if (!strcmp(a, "--gate-confidence") && has_value) o.gate_confidence = atof(argv[++i]);
+		else if (!strcmp(a, "--seconds") && has_value) o.seconds = atof(argv[++i]);
+		else if (!strcmp(a, "--calib") && has_value) {
+			ppg_calib_table_t calib;
+			if (!calib_parse(argv[++i], &calib) || !ppg_calib_set(&calib)) {
+				fprintf(stderr, "--calib: need 2..%d R:SpO2 points, R increasing\n", PPG_CALIB_MAX_POINTS);
+				return 2;
+			}
+		}
+		else if (!strcmp(a, "--estimator") && has_value) {
+			const char *e = argv[++i];
+			if (!strcmp(e, "autocorr")) o.estimator = HR_ESTIMATOR_AUTOCORRELATION;
+			else if (!strcmp(e, "spectral")) o.estimator = HR_ESTIMATOR_SPECTRAL;
+			else if (!strcmp(e, "beats")) o.estimator = HR_ESTIMATOR_BEATS;
+			else usage();
+		}
+		else if (a[0] != '-' && !path) path = a;
+		else usage();
+	}
+	if ((!path == isnan(o.synth_bpm)) || o.rate <= 0 || o.hop <= 0) {
+		usage();
+	}
+	if (o.estimator == HR_ESTIMATOR_BEATS) {
+		o.stream = true;   // The beat detector needs the band-passed stream
+	}
+
+	trace_t t = {0};
+	if (path) {
+		if (!trace_load_csv(&t, path)) {
+			fprintf(stderr, "%s: no samples\n", path);
+			return 2;
+		}
+	} else {
+		trace_synth(&t, &o);
+		if (isnan(o.ref_resp)) {
+			o.ref_resp = o.synth_resp;
+		}
+	}
+
+	// Rate given as an ADC rate with averaging 1: same context as the firmware
+	algorithm_init((uint32_t)o.rate, 1, o.window);
+	if (o.hop > algo_ctx.window_len) {
+		o.hop = algo_ctx.window_len;
+	}
+	printf("%s: %zu samples at %.0f Hz, window %d, hop %d, %s, %s path%s\n",
+	       path ? path : "synthetic", t.len, algo_ctx.sample_rate, algo_ctx.window_len, o.hop,
+	       o.estimator == HR_ESTIMATOR_SPECTRAL ? "spectral" :
+	       o.estimator == HR_ESTIMATOR_BEATS ? "beats" : "autocorrelation",
+	       o.stream ? "stream" : "block", PPG_FIXED_POINT ? ", fixed point" : "");
+
+	stats_t s = {0};
+	if (o.stream) {
+		replay_stream(&t, &o, &s);
+	} else {
+		replay_block(&t, &o, &s);
+	}
+
+	uint32_t rejected = 0;
+	for (int q = 0; q <= PPG_QUALITY_NOISY; q++) {
+		rejected += s.rejected[q];
+	}
+	printf("windows: %u (%u rejected by the quality gate", s.windows, rejected);
+	for (int q = 1; q <= PPG_QUALITY_NOISY; q++) {
+		if (s.rejected[q]) {
+			printf(", %s %u", ppg_quality_name((ppg_quality_t)q), s.rejected[q]);
+		}
+	}
+	printf(")\n");
+
+	uint32_t evaluated = s.windows - rejected;
+	double bpm_mae = s.bpm_scored ? s.bpm_abs_err / s.bpm_scored : NAN;
+	double spo2_mae = s.spo2_scored ? s.spo2_abs_err / s.spo2_scored : NAN;
+	if (s.bpm_scored) {
+		printf("HR:   MAE %.2f BPM, %.1f %% within +-%.0f BPM (%u windows)\n",
+		       bpm_mae, 100.0 * s.bpm_within / s.bpm_scored, o.tol_bpm, s.bpm_scored);
+	}
+	if (s.spo2_scored) {
+		printf("SpO2: MAE %.2f %% (%u windows)\n", spo2_mae, s.spo2_scored);
+	}
+	double resp_mae = s.resp_scored ? s.resp_abs_err / s.resp_scored : NAN;
+	if (s.resp_due) {
+		printf("Resp: MAE %.2f /min (%u estimates, %.0f %% of those due)\n", resp_mae, s.resp_scored,
+		       100.0 * s.resp_scored / s.resp_due);
+	}
+	double conf_mean = s.conf_scored ? s.conf_sum / s.conf_scored : NAN;
+	if (s.conf_scored) {
+		printf("Confidence: mean %.1f, %u of %u windows below %.0f\n", conf_mean, s.conf_low,
+		       s.conf_scored, o.min_confidence);
+	}
+	if (evaluated) {
+		printf("time: %.1f us/window mean, %.1f us max (detrend/copy, quality gate, estimator, SpO2)\n",
+		       s.time_sum_us / evaluated, s.time_max_us);
+	}
+
+	// Gates: a run with nothing to score fails too, it proves nothing
+	int status = 0;
+	if (!isnan(o.gate_bpm) && !(bpm_mae <= o.gate_bpm)) {
+		printf("FAIL: BPM MAE above %.2f\n", o.gate_bpm);
+		status = 1;
+	}
+	if (!isnan(o.gate_spo2) && !(spo2_mae <= o.gate_spo2)) {
+		printf("FAIL: SpO2 MAE above %.2f\n", o.gate_spo2);
+		status = 1;
+	}
+	if (!isnan(o.gate_resp) && !(resp_mae <= o.gate_resp)) {
+		printf("FAIL: respiratory rate MAE above %.2f\n", o.gate_resp);
+		status = 1;
+	}
+	if (!isnan(o.gate_confidence) && !(conf_mean >= o.gate_confidence)) {
+		printf("FAIL: mean confidence below %.1f\n", o.gate_confidence);
+		status = 1;
+	}
+
+	free(t.red);
+	free(t.ir);
+	free(t.ref_bpm);
+	free(t.ref_spo2);
+	return status;
+}